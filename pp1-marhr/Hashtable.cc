@@ -2,11 +2,7 @@
 
 #include "Hashtable.h"
 
-Hashtable::Hashtable() {
-	for (int i = 0; i < SIZE; i++) {
-		keys[i] = string();
-		values[i] = string();
-	}
+Hashtable::Hashtable() : slots(INITIAL_SIZE), count(0), used(0) {
 }
 
 Hashtable::~Hashtable()
@@ -14,64 +10,121 @@ Hashtable::~Hashtable()
 
 }
 
-unsigned int Hashtable::hash(const string& key){
+unsigned int Hashtable::hash(const char *key, size_t len){
 	unsigned int value = 0 ;
-	for (int i = 0; i < key.length(); i++){
+	for (int i = 0; i < len; i++){
 		value = 37*value + key[i];
 	}
-	return value;
+	// names differ in a character or two, which leaves runs of nearby
+	// values that linear probing piles up on; the table uses the low
+	// bits, so mix every bit into them (the finalizer of MurmurHash3)
+	value ^= value >> 16;
+	value *= 0x85ebca6b;
+	value ^= value >> 13;
+	value *= 0xc2b2ae35;
+	return value ^ (value >> 16);
 }
 
 void Hashtable::print() {
 	cout << "{";
-	for (int i = 0; i < SIZE; i++){
-		if (!keys[i].empty()){
-			cout << keys[i] << ":" << values[i] << ", ";
+	for (int i = 0; i < slots.size(); i++){
+		if (slots[i].state == FULL){
+			cout << slots[i].key << ":" << slots[i].value << ", ";
 		}
 	}
 	cout << "}" << endl;
 }
 
-int Hashtable::find_index(const string& key, bool override_duplicate_key = true) {
-	unsigned int h = hash(key) % SIZE, offset = 0, index;  
-	while (offset < SIZE) {
-		index = (h + offset) % SIZE;
+// Returns the slot holding key, or -1 if it is not there. With for_insert
+// a missing key gets the slot it should go in instead: the first tombstone
+// passed on the way, else the empty slot that ended the probe. The table
+// always has an empty slot, so the probe ends.
+int Hashtable::find_index(const char *key, size_t len, unsigned int h, bool for_insert) {
+	unsigned int mask = slots.size() - 1, index = h & mask;
+	int tombstone = -1;
+	while (slots[index].state != EMPTY) {
+		if (slots[index].state == FULL) {
+			const string &k = slots[index].key;
+			if (slots[index].hash == h && k.size() == len && !memcmp(k.data(), key, len))
+				return index;
+		} else if (tombstone == -1) {
+			tombstone = index;
+		}
+		index = (index + 1) & mask;
+	}
+	if (!for_insert)
+		return -1;
+	return tombstone != -1 ? tombstone : index;
+}
 
-		if (keys[index].empty() || (override_duplicate_key && keys[index] == key))
-			return index;
-		offset++;
+// Rehashes the live entries into a table of new_capacity slots (a power
+// of two), which also clears out the tombstones.
+void Hashtable::resize(unsigned int new_capacity) {
+	vector<Slot> old(new_capacity);
+	old.swap(slots);
+	used = count;
+	unsigned int mask = new_capacity - 1;
+	for (int i = 0; i < old.size(); i++) {
+		if (old[i].state != FULL)
+			continue;
+		unsigned int index = old[i].hash & mask;
+		while (slots[index].state != EMPTY)
+			index = (index + 1) & mask;
+		Slot &s = slots[index];
+		s.state = FULL;
+		s.hash = old[i].hash;
+		s.key.swap(old[i].key);
+		s.value.swap(old[i].value);
 	}
-	return -1;
 }
 
 void Hashtable::insert(const string& key, const string& value) {
-	int index = find_index(key);
-	if (index == -1) {
-		cout << "is full!" << endl;
+	unsigned int h = hash(key.data(), key.size());
+	int index = find_index(key.data(), key.size(), h, true);
+	Slot &s = slots[index];
+	if (s.state == FULL) {	// already defined, the new value replaces it
+		s.value = value;
 		return;
 	}
+	if (s.state == EMPTY) {
+		if (4*(used + 1) > 3*slots.size()) {
+			// grow if the live entries need it, else just drop tombstones
+			resize(4*(count + 1) > slots.size() ? 2*slots.size() : slots.size());
+			insert(key, value);
+			return;
+		}
+		used++;
+	}
+	s.state = FULL;
+	s.hash = h;
+	s.key = key;
+	s.value = value;
+	count++;
+}
 
-	keys[index] = key;
-	values[index] = value;
+const string *Hashtable::find(const string& key) {
+	return find(key.data(), key.size());
 }
 
-string Hashtable::find(const string& key) {
-	// printf("%s:%d\n", __PRETTY_FUNCTION__,__LINE__);
-	int index = find_index(key);
+const string *Hashtable::find(const char *key, size_t len) {
+	int index = find_index(key, len, hash(key, len), false);
 	if (index != -1)
-		return values[index];
+		return &slots[index].value;
 
-	return "";
+	return NULL;
 }
 
 string Hashtable::remove(const string& key) {
-	int index = find_index(key);
-	if (index == -1) 
+	int index = find_index(key.data(), key.size(), hash(key.data(), key.size()), false);
+	if (index == -1)
 		return "";
 
-	string value = values[index];
-	keys[index].clear();
-	values[index].clear();
+	Slot &s = slots[index];
+	string value;
+	value.swap(s.value);
+	s.key.clear();
+	s.state = DELETED;
+	count--;
 
 	return value;
-}
\ No newline at end of file
+}
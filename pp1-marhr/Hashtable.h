@@ -1,9 +1,22 @@
 // Mariana Hernandez
+//
+// Table of the #define'd macros, name -> replacement. It is an open
+// addressing table with linear probing that doubles in size before it
+// gets three quarters full, so it holds any number of macros and a probe
+// for a name that is not there stops at the first empty slot. Removing
+// a name leaves a tombstone in its slot, so the names probed past it are
+// still found; tombstones are reused by inserts and dropped on a resize.
+// find() hands back the stored replacement itself rather than a copy,
+// and can look up a name straight out of the scanner's text.
+
+#ifndef _H_Hashtable
+#define _H_Hashtable
 
 #include <iostream>
 #include <stdio.h>
 #include <string>
-#include <queue>
+#include <vector>
+#include <string.h>
 using namespace std;
 
 class Hashtable{
@@ -12,16 +25,31 @@ class Hashtable{
 	Hashtable(string file);
 	virtual ~Hashtable();
 
-	string find(const string& key);
+	const string *find(const string& key);   // NULL if not defined
+	const string *find(const char *key, size_t len);
 	void insert(const string& key, const string& value);
 	string remove(const string& key);
 	void print();
-	
+	int size() const { return count; }
+
 	protected:
-	unsigned int hash(const string& key);
-	int find_index(const string& key, bool override_duplicated_key);
-	
-	const static unsigned int SIZE = 100;
-	string keys[SIZE];
-	string values[SIZE];
-};
\ No newline at end of file
+	enum SlotState { EMPTY, FULL, DELETED };
+	struct Slot {
+		SlotState state;
+		unsigned int hash;
+		string key;
+		string value;
+		Slot() : state(EMPTY), hash(0) {}
+	};
+
+	unsigned int hash(const char *key, size_t len);
+	int find_index(const char *key, size_t len, unsigned int h, bool for_insert);
+	void resize(unsigned int new_capacity);
+
+	const static unsigned int INITIAL_SIZE = 16;
+	vector<Slot> slots;
+	unsigned int count;   // FULL slots
+	unsigned int used;    // FULL and DELETED slots, what a probe may cross
+};
+
+#endif
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+# File: dppbench.py
+# -----------------
+# Measures how fast each preprocessor given runs, in MB/s. The input is
+# a number of #defines followed by lines that use them, with block and
+# line comments and strings mixed in, repeated to the given size in MB.
+# Each preprocessor runs it 5 times with the output thrown away, and the
+# least CPU time (user + system) is the one reported:
+#
+#     make dpp
+#     bench/dppbench.py 50 1000 ./dpp
+#
+# The arguments are the size in MB, the number of #defines and the
+# preprocessors to time. make dppbench does the same.
+
+import os
+import resource
+import subprocess
+import sys
+import tempfile
+
+if len(sys.argv) < 4:
+    sys.exit("usage: dppbench.py <MB> <defines> <dpp> [dpp...]")
+size = float(sys.argv[1]) * 1024 * 1024
+defines = int(sys.argv[2])
+programs = sys.argv[3:]
+
+
+def name(i):
+    """The i-th macro name; names are upper case letters only."""
+    s = "M"
+    while True:
+        s += chr(ord("A") + i % 26)
+        i //= 26
+        if not i:
+            return s
+
+
+def cpu_time(program, path):
+    before = resource.getrusage(resource.RUSAGE_CHILDREN)
+    with open(path, "rb") as input, open(os.devnull, "wb") as null:
+        status = subprocess.call([program], stdin=input, stdout=null, stderr=null)
+    if status < 0:
+        sys.exit("%s died with signal %d" % (program, -status))
+    after = resource.getrusage(resource.RUSAGE_CHILDREN)
+    return (after.ru_utime - before.ru_utime) + (after.ru_stime - before.ru_stime)
+
+
+body = "".join(
+    "/* the value of %s,\n * kept in x%d */\n"
+    "int x%d = #%s + y * 2; // and some more\n"
+    "Print(\"#%s is not expanded /* inside */ a string\", x%d);\n"
+    % (name(i), i, i, name(i), name(i), i) for i in range(defines))
+
+with tempfile.NamedTemporaryFile(suffix=".frag") as input:
+    for i in range(defines):
+        input.write(("#define %s (%d + %d)\n" % (name(i), i, i)).encode())
+    body = body.encode()
+    for _ in range(int(size // len(body)) + 1):
+        input.write(body)
+    input.flush()
+    mb = os.path.getsize(input.name) / (1024.0 * 1024)
+    for program in programs:
+        seconds = min(cpu_time(program, input.name) for _ in range(5))
+        print("%s: %.1f MB in %.3f s, %.0f MB/s"
+              % (os.path.basename(program), mb, seconds, mb / max(seconds, 1e-6)))
@@ -0,0 +1,94 @@
+/* File: hashbench.cc
+ * ------------------
+ * Micro-benchmark for the macro table (see Hashtable.h). For each number
+ * of macros given on the command line (10k, 30k and 100k if none are),
+ * it times defining that many names, substituting each one three times,
+ * looking up as many names that were never defined, and removing them
+ * all again.
+ *
+ *     make hashbench && ./hashbench 10000 100000
+ *
+ * The names are upper case letters only, like the ones dpp accepts. How
+ * dpp itself does with that many #defines is measured by dppbench.py:
+ *
+ *     bench/dppbench.py 50 100000 ./dpp
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Hashtable.h"
+using namespace std;
+
+static double Millis(chrono::steady_clock::time_point start)
+{
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+static string Name(const char *prefix, int i)
+{
+    string name = prefix;
+    do {
+        name += (char)('A' + i % 26);
+        i /= 26;
+    } while (i);
+    return name;
+}
+
+static void Run(int n)
+{
+    vector<string> names(n), missing(n), values(n);
+    for (int i = 0; i < n; i++) {
+        names[i] = Name("M", i);
+        missing[i] = Name("U", i);
+        values[i] = "(" + to_string(i) + " + 1)";
+    }
+
+    Hashtable *table = new Hashtable;
+    long found = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        table->insert(names[i], values[i]);
+    double defines = Millis(start);
+
+    start = chrono::steady_clock::now();
+    for (int round = 0; round < 3; round++)
+        for (int i = 0; i < n; i++) {
+            const string *rep = table->find(names[i].data(), names[i].size());
+            found += rep && rep->size() == values[i].size();
+        }
+    double uses = Millis(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        found += table->find(missing[i].data(), missing[i].size()) != NULL;
+    double misses = Millis(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        table->remove(names[i]);
+    double removes = Millis(start);
+
+    if (found != 3L*n || table->size() != 0) {
+        fprintf(stderr, "hashbench: wrong results for %d macros\n", n);
+        exit(1);
+    }
+    delete table;
+    printf("%8d macros: define %8.2f ms  3x use %8.2f ms  undefined %8.2f ms  remove %8.2f ms\n",
+           n, defines, uses, misses, removes);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1) {
+        Run(10000);
+        Run(30000);
+        Run(100000);
+    }
+    for (int i = 1; i < argc; i++)
+        Run(atoi(argv[i]));
+    return 0;
+}
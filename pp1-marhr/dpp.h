@@ -0,0 +1,33 @@
+/* File: dpp.h
+ * -----------
+ * The preprocessor, as a stage the compiler runs in-process rather than
+ * as a separate program it reads from through a pipe. It strips comments
+ * and handles the # directives of its input and hands back the result
+ * in chunks, as the caller asks for them. The scanner takes its input
+ * this way (see YY_INPUT in scanner.l), and the standalone dpp program
+ * is just a loop copying the chunks to stdout.
+ */
+
+#ifndef _H_dpp
+#define _H_dpp
+
+#include <stdio.h>
+
+
+/* Function: InitPreprocessor
+ * --------------------------
+ * Sets up the preprocessor to read from fp, starting over at line 1.
+ * Must be called before Preprocess().
+ */
+void InitPreprocessor(FILE *fp);
+
+
+/* Function: Preprocess
+ * --------------------
+ * Fills buf with up to max characters of preprocessed output and returns
+ * how many it stored, 0 once all of the input has been processed. Only
+ * as much input is read as is needed to produce them.
+ */
+int Preprocess(char *buf, int max);
+
+#endif
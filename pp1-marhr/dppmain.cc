@@ -1,38 +1,44 @@
 /* File: dppmain.cc
  * ----------------
- * This file defines the main() routine for the preprocessor, 
- * the filtering tool which runs before the compiler.
+ * This file defines the main() routine for the standalone preprocessor,
+ * the filtering tool the compiler runs as its first stage.
  */
  
-#include "scanner.h"
 #include <stdio.h>
-#include "errors.h"
-#include "Hashtable.h"
+#include <stdlib.h>
+#include <string.h>
+#include "utility.h"
+#include "dpp.h"
 
 
 
 /* Function: main()
  * ----------------
- * Entry point to the preprocessor.
- * As given below, this "filter" just copies stdin to stdout unchanged.
- * It will be your job to actually do some filtering, either by hand-coded
- * transformation of the input or by setting up a lex scanner in the dpp.l
- * file and changing the main below to invoke it via yylex. When finished,
- * the preprocessor should echo stdin to stdout making the transformations
- * to strip comments and handle preprocessor directives.
+ * Entry point to the preprocessor. The work is done by the preprocessor
+ * stage in dpp.l (the compiler runs the same stage in-process), this just
+ * copies its output from stdin to stdout, a buffer at a time. With
+ * --chunk=N (given ahead of any -d) it asks for N characters at a time
+ * instead, which is how make check-dpp tries comments, strings and
+ * directives split across the ends of the pieces handed out.
  */
 int main(int argc, char *argv[])
 {
-  //int ch;
-  //while ((ch = getc(stdin)) != EOF)
-  //  putc(ch, stdout);
-  yylex();
+  static char buf[64*1024];
+  int chunk = sizeof(buf);
+  if (argc > 1 && strncmp(argv[1], "--chunk=", 8) == 0) {
+    chunk = atoi(argv[1] + 8);
+    if (chunk <= 0 || chunk > (int)sizeof(buf)) {
+      printf("Usage:   [--chunk=1..%d] [-d <debug-key-1> ...]\n", (int)sizeof(buf));
+      exit(2);
+    }
+    argv[1] = argv[0];      // the rest is for ParseCommandLine
+    argc--;
+    argv++;
+  }
+  ParseCommandLine(argc, argv);
+  InitPreprocessor(stdin);
+  int n;
+  while ((n = Preprocess(buf, chunk)) > 0)
+    fwrite(buf, 1, n, stdout);
   return 0;
 }
-
-
-
-
-
-
-
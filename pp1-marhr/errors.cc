@@ -13,16 +13,23 @@ using namespace std;
 
 
 int ReportError::numErrors = 0;
+ReportError::Sink ReportError::sink = NULL;
 
  
 void ReportError::OutputError(yyltype *loc, string msg) {
     numErrors++;
-    fflush(stdout); // make sure any buffered text has been output
+    stringstream s;
     if (loc) {
-        cerr << endl << "*** Error line " << loc->first_line << "." << endl;
+        s << endl << "*** Error line " << loc->first_line << "." << endl;
     } else
-        cerr << endl << "*** Error." << endl;
-    cerr << "*** " << msg << endl << endl;
+        s << endl << "*** Error." << endl;
+    s << "*** " << msg << endl << endl;
+    if (sink) {
+        sink(s.str());
+        return;
+    }
+    fflush(stdout); // make sure any buffered text has been output
+    cerr << s.str() << flush;
 }
 
 
@@ -58,12 +58,18 @@ class ReportError
 
   // Returns number of error messages printed
   static int NumErrors() { return numErrors; }
+
+  // Hands each error message, as the full text that would be printed,
+  // to sink instead of printing it to cerr (NULL goes back to cerr)
+  typedef void (*Sink)(const string &text);
+  static void SetSink(Sink s) { sink = s; }
   
  private:
 
   static void UnderlineErrorInLine(const char *line, yyltype *pos);
   static void OutputError(yyltype *loc, string msg);
   static int numErrors;
+  static Sink sink;
   
 };
 
@@ -1,7 +1,6 @@
 /* File: main.cc
  * -------------
  * This file defines the main() routine for the program and not much else.
- * You should not need to modify this file.
  */
  
 #include <string.h>
@@ -10,65 +9,50 @@
 #include "errors.h"
 #include "scanner.h"
 #include "location.h"
-
-/* Function: PrintOneToken()
- * Usage: PrintOneToken(T_Double, "3.5", val, loc);
- * -----------------------------------------------
- * We supply this function to print information about the tokens returned
- * by the lexer as part of pp1.  Do not modifiy it.
- */
-static void PrintOneToken(TokenType token, const char *text, YYSTYPE value,
-                          yyltype loc)
-{
-  char buffer[] = {'\'', token, '\'', '\0'};
-  const char *name = token >= T_Void ? gTokenNames[token - T_Void] : buffer;
-  
-  printf("%-12s line %d cols %d-%d is %s ", text,
-	   loc.first_line, loc.first_column, loc.last_column, name);
-  
-  switch(token) {
-    case T_IntConstant:     
-      printf("(value = %d)\n", value.integerConstant); break;
-    case T_DoubleConstant:   
-      printf("(value = %g)\n", value.doubleConstant); break;
-    case T_StringConstant:  
-      printf("(value = %s)\n", value.stringConstant); break;
-    case T_BoolConstant:    
-      printf("(value = %s)\n", value.boolConstant ? "true" : "false"); break;
-    case T_Identifier:
-	if (strcmp(text, value.identifier)) {
-	  printf("(truncated to %s)\n", value.identifier);
-	  break;
-	}
-    default:
-      printf("\n"); break;
-  }
-}
-
+#include "dpp.h"
+#include "tokenstream.h"
 
 /* Function: main()
  * ----------------
  * Entry point to the entire program.  We parse the command line and turn
  * on any debugging flags requested by the user when invoking the program.
- * The UNIX popen command is used to first invoke the preprocessor to
- * filter the input and we feed that result into the scanner as input.
- * (This is somewhat unusual -- ordinarily lex would just read directly
- * from the usual stdin, without the calls to popen/yyrestart)
- * InitScanner() is used to set up the scanner.
+ * The preprocessor filters the input in the same process and the scanner
+ * reads what it produces (see YY_INPUT in scanner.l), so InitPreprocessor()
+ * points it at stdin and InitScanner() is used to set up the scanner.
  * Once everything is set up, we loop, calling yylex() to get each token
  * and print out its info. We continue until all input has been scanned.
+ * With --tokens=binary (given ahead of any -d) the tokens and errors are
+ * written as a binary stream instead, which tokdecode turns back into
+ * the usual text (see tokenstream.h).
  */
 int main(int argc, char *argv[])
 {
+    bool binary = false;
+    if (argc > 1 && strncmp(argv[1], "--tokens=", 9) == 0) {
+        if (strcmp(argv[1], "--tokens=binary") == 0)
+            binary = true;
+        else if (strcmp(argv[1], "--tokens=text") != 0) {
+            printf("Usage:   [--tokens=text|binary] [-d <debug-key-1> ...]\n");
+            exit(2);
+        }
+        argv[1] = argv[0];      // the rest is for ParseCommandLine
+        argc--;
+        argv++;
+    }
     ParseCommandLine(argc, argv);
-    FILE *filtered = popen("./dpp", "r"); // start up the preprocessor
-    yyrestart(filtered); // tell lex to read from output of preprocessor
-  
+    InitPreprocessor(stdin);
     InitScanner();
     TokenType token;
-    while ((token = (TokenType)yylex()) != 0) 
-        PrintOneToken(token, yytext, yylval, yylloc);
-    pclose(filtered);
+    if (binary) {
+        BeginBinaryTokens(stdout);
+        ReportError::SetSink(WriteBinaryError);
+        while ((token = (TokenType)yylex()) != 0)
+            WriteBinaryToken(token, yytext, yylval, yylloc);
+        EndBinaryTokens();
+    } else {
+        while ((token = (TokenType)yylex()) != 0)
+            PrintOneToken(token, yytext, yylval, yylloc);
+    }
     return (ReportError::NumErrors() == 0? 0 : -1);
 }
 
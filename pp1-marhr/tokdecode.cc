@@ -0,0 +1,20 @@
+/* File: tokdecode.cc
+ * ------------------
+ * This file defines the main() routine for tokdecode, which reads the
+ * binary token stream written by dcc --tokens=binary from stdin and
+ * prints it in dcc's usual text format.
+ */
+
+#include <stdio.h>
+#include "tokenstream.h"
+
+
+int main(int argc, char *argv[])
+{
+  if (!DecodeBinaryTokens(stdin)) {
+    fflush(stdout);
+    fprintf(stderr, "tokdecode: input is not a well-formed token stream\n");
+    return 1;
+  }
+  return 0;
+}
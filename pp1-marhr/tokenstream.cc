@@ -0,0 +1,223 @@
+/* File: tokenstream.cc
+ * --------------------
+ * Implementation of the text and binary token formats.
+ *
+ * A binary stream starts with a magic string and is then a sequence of
+ * Records. A record of kind StringDef is followed by line bytes of
+ * string data, the strings are numbered from 0 in the order they are
+ * defined, and every string is defined before the first record that
+ * uses it. A record of kind ErrorMessage stands for an error message,
+ * the one in string number text. Any other record is a token, kind is
+ * its TokenType and text is the string number of its lexeme.
+ */
+
+#include "tokenstream.h"
+#include <string.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+static const char Magic[8] = {'D', 'T', 'O', 'K', 'E', 'N', 'S', '1'};
+enum { StringDef = -1, ErrorMessage = -2 };
+
+struct Record {
+    int32_t kind;
+    int32_t line, firstColumn, lastColumn;
+    int32_t text;
+    int32_t unused;
+    union {
+        int32_t integer;   // T_IntConstant, T_BoolConstant
+        int32_t string;    // T_StringConstant, T_Identifier: string number
+        double number;     // T_DoubleConstant
+    } value;
+};
+
+
+/* Function: PrintOneToken()
+ * -------------------------
+ * We supply this function to print information about the tokens returned
+ * by the lexer as part of pp1.  Do not modifiy it.
+ */
+void PrintOneToken(TokenType token, const char *text, YYSTYPE value,
+                   yyltype loc)
+{
+  char buffer[] = {'\'', (char)token, '\'', '\0'};
+  const char *name = token >= T_Void ? gTokenNames[token - T_Void] : buffer;
+
+  printf("%-12s line %d cols %d-%d is %s ", text,
+	   loc.first_line, loc.first_column, loc.last_column, name);
+
+  switch(token) {
+    case T_IntConstant:
+      printf("(value = %d)\n", value.integerConstant); break;
+    case T_DoubleConstant:
+      printf("(value = %g)\n", value.doubleConstant); break;
+    case T_StringConstant:
+      printf("(value = %s)\n", value.stringConstant); break;
+    case T_BoolConstant:
+      printf("(value = %s)\n", value.boolConstant ? "true" : "false"); break;
+    case T_Identifier:
+	if (strcmp(text, value.identifier)) {
+	  printf("(truncated to %s)\n", value.identifier);
+	  break;
+	}
+    default:
+      printf("\n"); break;
+  }
+}
+
+
+/* The writer side: the output buffer and the strings defined so far. */
+static FILE *out;
+static char outBuf[64*1024];
+static size_t outLen;
+static std::unordered_map<std::string, int32_t> stringNumbers;
+static std::string lookupKey;   // reused so a lookup does not allocate
+
+static void Flush()
+{
+    fwrite(outBuf, 1, outLen, out);
+    outLen = 0;
+}
+
+static void Write(const void *data, size_t size)
+{
+    if (outLen + size > sizeof(outBuf)) {
+        Flush();
+        if (size > sizeof(outBuf)) {
+            fwrite(data, 1, size, out);
+            return;
+        }
+    }
+    memcpy(outBuf + outLen, data, size);
+    outLen += size;
+}
+
+/* Function: StringNumber
+ * ----------------------
+ * Returns the number of the string of the given length, writing out its
+ * definition first if this is its first use.
+ */
+static int32_t StringNumber(const char *s, size_t len)
+{
+    lookupKey.assign(s, len);
+    std::unordered_map<std::string, int32_t>::iterator it = stringNumbers.find(lookupKey);
+    if (it != stringNumbers.end())
+        return it->second;
+    int32_t number = stringNumbers.size();
+    stringNumbers[lookupKey] = number;
+    Record def;
+    memset(&def, 0, sizeof(def));
+    def.kind = StringDef;
+    def.line = len;
+    Write(&def, sizeof(def));
+    Write(s, len);
+    return number;
+}
+
+void BeginBinaryTokens(FILE *fp)
+{
+    out = fp;
+    outLen = 0;
+    stringNumbers.clear();
+    Write(Magic, sizeof(Magic));
+}
+
+void WriteBinaryToken(TokenType token, const char *text, YYSTYPE value,
+                      yyltype loc)
+{
+    Record r;
+    memset(&r, 0, sizeof(r));
+    r.kind = token;
+    r.line = loc.first_line;
+    r.firstColumn = loc.first_column;
+    r.lastColumn = loc.last_column;
+    r.text = StringNumber(text, strlen(text));
+    switch (token) {
+      case T_IntConstant:    r.value.integer = value.integerConstant; break;
+      case T_BoolConstant:   r.value.integer = value.boolConstant; break;
+      case T_DoubleConstant: r.value.number = value.doubleConstant; break;
+      case T_StringConstant:
+        r.value.string = StringNumber(value.stringConstant, strlen(value.stringConstant));
+        break;
+      case T_Identifier:
+        r.value.string = StringNumber(value.identifier, strlen(value.identifier));
+        break;
+      default: break;
+    }
+    Write(&r, sizeof(r));
+}
+
+void WriteBinaryError(const std::string &message)
+{
+    Record r;
+    memset(&r, 0, sizeof(r));
+    r.kind = ErrorMessage;
+    r.text = StringNumber(message.data(), message.size());
+    Write(&r, sizeof(r));
+}
+
+void EndBinaryTokens()
+{
+    Flush();
+    fflush(out);
+}
+
+
+/* Function: DecodeBinaryTokens()
+ * ------------------------------
+ * Reads the records back in order, keeping the strings as they are
+ * defined, and prints each token with PrintOneToken and each error to
+ * stderr.
+ */
+bool DecodeBinaryTokens(FILE *fp)
+{
+    char magic[sizeof(Magic)];
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, Magic, sizeof(Magic)))
+        return false;
+
+    std::vector<std::string> strings;
+    Record r;
+    while (fread(&r, sizeof(r), 1, fp) == 1) {
+        if (r.kind == StringDef) {
+            std::string s(r.line, '\0');
+            if (r.line < 0 || (r.line > 0 && fread(&s[0], 1, r.line, fp) != (size_t)r.line))
+                return false;
+            strings.push_back(s);
+            continue;
+        }
+        if (r.text < 0 || r.text >= (int32_t)strings.size())
+            return false;
+        if (r.kind == ErrorMessage) {   // to stderr, as the error reporter does
+            fflush(stdout);
+            fwrite(strings[r.text].data(), 1, strings[r.text].size(), stderr);
+            continue;
+        }
+
+        TokenType token = (TokenType)r.kind;
+        YYSTYPE value;
+        memset(&value, 0, sizeof(value));
+        switch (token) {
+          case T_IntConstant:    value.integerConstant = r.value.integer; break;
+          case T_BoolConstant:   value.boolConstant = r.value.integer; break;
+          case T_DoubleConstant: value.doubleConstant = r.value.number; break;
+          case T_StringConstant:
+          case T_Identifier:
+            if (r.value.string < 0 || r.value.string >= (int32_t)strings.size())
+                return false;
+            if (token == T_StringConstant)
+                value.stringConstant = (char *)strings[r.value.string].c_str();
+            else
+                strncpy(value.identifier, strings[r.value.string].c_str(), MaxIdentLen);
+            break;
+          default: break;
+        }
+        yyltype loc;
+        memset(&loc, 0, sizeof(loc));
+        loc.first_line = r.line;
+        loc.first_column = r.firstColumn;
+        loc.last_column = r.lastColumn;
+        PrintOneToken(token, strings[r.text].c_str(), value, loc);
+    }
+    return feof(fp) != 0;
+}
@@ -0,0 +1,53 @@
+/* File: tokenstream.h
+ * -------------------
+ * The two ways the scanner driver can write out the tokens it scans.
+ * The text format (PrintOneToken) is the one the .out files in samples
+ * hold. The binary format writes a fixed-width record per token, with
+ * strings (lexemes, identifiers, string constants and error messages)
+ * written once each and then referred to by number. It is much cheaper
+ * to produce, and the tokdecode tool turns it back into the text format
+ * exactly, errors included, using the same PrintOneToken.
+ */
+
+#ifndef _H_tokenstream
+#define _H_tokenstream
+
+#include <stdio.h>
+#include <string>
+#include "scanner.h"
+#include "location.h"
+
+
+/* Function: PrintOneToken()
+ * Usage: PrintOneToken(T_Double, "3.5", val, loc);
+ * -----------------------------------------------
+ * Prints the text format line for one token to stdout.
+ */
+void PrintOneToken(TokenType token, const char *text, YYSTYPE value,
+                   yyltype loc);
+
+
+/* Functions: binary token output
+ * ------------------------------
+ * BeginBinaryTokens starts a binary stream on fp and EndBinaryTokens
+ * flushes it, the output is buffered in between. WriteBinaryError takes
+ * the full text of an error message as the error reporter would print
+ * it (see ReportError::SetSink) and records it in place in the stream.
+ */
+void BeginBinaryTokens(FILE *fp);
+void WriteBinaryToken(TokenType token, const char *text, YYSTYPE value,
+                      yyltype loc);
+void WriteBinaryError(const std::string &message);
+void EndBinaryTokens();
+
+
+/* Function: DecodeBinaryTokens()
+ * ------------------------------
+ * Reads a binary token stream from fp and prints it to stdout in the
+ * text format, with the errors to stderr where they occurred, just as
+ * dcc prints them. Returns false if
+ * the stream is not well formed.
+ */
+bool DecodeBinaryTokens(FILE *fp);
+
+#endif
@@ -0,0 +1,84 @@
+/* File: arena.cc
+ * --------------
+ * Implementation of the Arena class.
+ */
+
+#include "arena.h"
+#include "utility.h"
+#include "trace.h"
+
+Arena treeArena;
+thread_local Arena *threadArena = &treeArena;
+
+
+void UseOwnTreeArena()
+{
+    static thread_local Arena own;
+    threadArena = &own;
+}
+
+
+void *Arena::LockedAlloc(size_t size, kind k)
+{
+    std::lock_guard<std::mutex> hold(mutex);
+    return BumpAlloc(size, k);
+}
+
+
+/* Method: Grow
+ * ------------
+ * Called when the current block cannot satisfy a request of size bytes.
+ * Small requests start a fresh block. Requests larger than a quarter block
+ * get a block of their own, which is linked behind the current one so that
+ * the space left in the current block is not wasted.
+ */
+void *Arena::Grow(size_t size)
+{
+    const size_t header = (sizeof(Block) + Alignment - 1) & ~(Alignment - 1);
+    bool dedicated = size > BlockSize/4;
+    size_t total = header + (dedicated ? size : BlockSize);
+    Block *b = (Block *)malloc(total);
+    if (!b) Failure("Out of memory!");
+    numBlocks++;
+    reserved += total;
+    if (dedicated && blocks) {
+        b->prev = blocks->prev;
+        blocks->prev = b;
+        return (char *)b + header;
+    }
+    b->prev = blocks;
+    blocks = b;
+    next = (char *)b + header + size;
+    limit = (char *)b + total;
+    return (char *)b + header;
+}
+
+
+/* Method: Release
+ * ---------------
+ * Frees all the blocks and resets the arena to its empty state.
+ */
+void Arena::Release()
+{
+    while (blocks) {
+        Block *prev = blocks->prev;
+        free(blocks);
+        blocks = prev;
+    }
+    next = limit = NULL;
+    numBlocks = 0;
+    reserved = 0;
+    for (int i = 0; i < kNumKinds; i++) {
+        counts[i] = 0;
+        bytes[i] = 0;
+    }
+}
+
+
+void Arena::PrintStats()
+{
+    PrintDebug(kTraceArena, "%d nodes in %lu bytes", counts[kNode], (unsigned long)bytes[kNode]);
+    PrintDebug(kTraceArena, "%d lists in %lu bytes, %lu bytes of list storage",
+               counts[kList], (unsigned long)bytes[kList], (unsigned long)bytes[kListStorage]);
+    PrintDebug(kTraceArena, "%lu bytes reserved in %d blocks", (unsigned long)reserved, numBlocks);
+}
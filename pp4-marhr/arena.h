@@ -0,0 +1,115 @@
+/* File: arena.h
+ * -------------
+ * This file defines the Arena class, a simple bump allocator used to
+ * hold the parse tree. Every Node, every List and the storage behind
+ * those lists is carved out of a few large blocks instead of being a
+ * separate trip through malloc, which keeps the tree compact and makes
+ * building it cheap.
+ *
+ * Nothing allocated from an arena is ever freed on its own. The whole
+ * arena is released in one step (see Release), which for the global
+ * treeArena happens when the program exits.
+ *
+ * Trees are built in the arena TreeArena returns, which is treeArena
+ * unless the calling thread has switched to one of its own. Batch mode
+ * (see batch.h) gives each of its threads an arena, which it releases
+ * after every file, and the compiler server (see server.h) releases its
+ * own before every full compile.
+ *
+ * The ArenaAllocator template below adapts an arena to the STL
+ * allocator interface, so that the containers inside Scope and Hashtable
+ * can place their storage in the arena as well.
+ */
+
+#ifndef _H_arena
+#define _H_arena
+
+#include <stddef.h>
+#include <mutex>
+
+class Arena
+{
+  public:
+    typedef enum { kNode, kList, kListStorage, kOther, kNumKinds } kind;
+
+    // The constructor is constexpr so the global arena is initialized
+    // before any other static object (the builtin types, the scanner's
+    // saved lines, ...) and thus also destroyed after all of them.
+    constexpr Arena() : blocks(NULL), next(NULL), limit(NULL),
+                        numBlocks(0), reserved(0), counts(), bytes(),
+                        locking(false) {}
+    ~Arena() { Release(); }
+
+          // Returns size bytes of suitably aligned, uninitialized memory.
+          // The kind only serves to keep the statistics.
+    void *Alloc(size_t size, kind k = kOther)
+        { return locking ? LockedAlloc(size, k) : BumpAlloc(size, k); }
+
+          // Turns on locking around Alloc, needed while more than one
+          // thread allocates from the arena (see Program::Check).
+    void SetLocking(bool on) { locking = on; }
+
+          // Frees every block in one step. Anything allocated from the
+          // arena must not be used afterwards.
+    void Release();
+
+          // Prints byte and object counts under the "arena" debug key
+    void PrintStats();
+
+          // How many allocations of the kind were made, and their total
+          // size, since the arena was made or last released
+    int Count(kind k) const { return counts[k]; }
+    size_t Bytes(kind k) const { return bytes[k]; }
+
+  private:
+    static const size_t Alignment = 16;
+    static const size_t BlockSize = 64*1024;
+    struct Block { Block *prev; };
+
+    Block *blocks;         // most recent block, linked to the older ones
+    char *next, *limit;    // free space left in the current block
+    int numBlocks;
+    size_t reserved;
+    int counts[kNumKinds];
+    size_t bytes[kNumKinds];
+    bool locking;
+    std::mutex mutex;
+
+    void *BumpAlloc(size_t size, kind k)
+        { size = (size + Alignment - 1) & ~(Alignment - 1);
+          counts[k]++; bytes[k] += size;
+          if (size > (size_t)(limit - next)) return Grow(size);
+          void *p = next;
+          next += size;
+          return p; }
+    void *LockedAlloc(size_t size, kind k);
+    void *Grow(size_t size);
+};
+
+extern Arena treeArena;  // holds the parse tree (see Node::operator new)
+
+// The arena the calling thread builds its tree in. UseOwnTreeArena
+// switches the thread to an arena of its own, which is released when
+// the thread ends. All other threads share treeArena, including any a
+// thread with its own arena starts.
+extern thread_local Arena *threadArena;
+inline Arena &TreeArena() { return *threadArena; }
+void UseOwnTreeArena();
+
+
+template <class T> class ArenaAllocator {
+  public:
+    typedef T value_type;
+
+    ArenaAllocator() {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U>&) {}
+
+    T *allocate(size_t n)
+        { return (T *)TreeArena().Alloc(n*sizeof(T), Arena::kListStorage); }
+    void deallocate(T *, size_t) {} // released along with the arena
+
+    template <class U> bool operator==(const ArenaAllocator<U>&) const { return true; }
+    template <class U> bool operator!=(const ArenaAllocator<U>&) const { return false; }
+};
+
+#endif
@@ -7,33 +7,124 @@
 #include "ast_decl.h"
 #include <string.h> // strdup
 #include <stdio.h>  // printf
+#include <atomic>
 #include "errors.h"
 #include "scope.h"
+#include "trace.h"
+#include <vector>
+
+struct LineShift { int afterLine, delta; };
+static std::vector<LineShift> shifts;
+unsigned int Node::numShifts = 0;
 
 Node::Node(yyltype loc) {
-    location = new yyltype(loc);
+    location = loc;
+    hasLocation = true;
+    kind = kOther;
+    shiftsSeen = numShifts;
     parent = NULL;
     nodeScope = NULL;
+    scopeOwner = NULL;
 }
 
 Node::Node() {
-    location = NULL;
+    hasLocation = false;
+    kind = kOther;
+    shiftsSeen = numShifts;
     parent = NULL;
     nodeScope = NULL;
+    scopeOwner = NULL;
+}
+
+void Node::ShiftLines(int afterLine, int delta) {
+    LineShift shift = { afterLine, delta };
+    shifts.push_back(shift);
+    numShifts = shifts.size();
+}
+
+void Node::ForgetShifts() {
+    shifts.clear();
+    numShifts = 0;
+}
+
+/* Method: ApplyShifts
+ * -------------------
+ * Catches the location up with the shifts made since it was last looked
+ * at, in order. The first and last lines move separately, a location
+ * spanning the line after which lines were added only grows.
+ */
+void Node::ApplyShifts() {
+    for (; shiftsSeen < numShifts; shiftsSeen++) {
+        const LineShift &s = shifts[shiftsSeen];
+        if (!hasLocation) continue;
+        if (location.first_line > s.afterLine) location.first_line += s.delta;
+        if (location.last_line > s.afterLine) location.last_line += s.delta;
+    }
+}
+
+/* Method: GetEnclosingScope
+ * --------------------------
+ * Returns the scope of the innermost node at or above this one that owns
+ * one, creating it if needed. The owner is found by climbing parents once,
+ * every node passed on the way up remembers it too.
+ */
+Scope *Node::GetEnclosingScope() {
+    if (!scopeOwner) {
+        Node *n = this;
+        while (n && !n->scopeOwner && !n->OwnsScope())
+            n = n->parent;
+        if (!n) return NULL; // nothing above owns a scope
+        Node *owner = n->scopeOwner ? n->scopeOwner : n;
+        for (Node *p = this; p != n; p = p->parent)
+            p->scopeOwner = owner;
+        if (!n->scopeOwner) n->scopeOwner = owner;
+    }
+    return scopeOwner->PrepareScope();
 }
 
 Decl *Node::FindDecl(Identifier *idToFind, lookup l) {
-    Decl *mine;
-    if (!nodeScope) PrepareScope();
-    if (nodeScope && (mine = nodeScope->Lookup(idToFind)))
-        return mine;
-    if (l == kDeep && parent)
-        return parent->FindDecl(idToFind, l);
-    return NULL;
-}
-	 
+    if (l == kShallow)
+        return OwnsScope() ? PrepareScope()->Lookup(idToFind) : NULL;
+    int depth = 0;
+    Decl *mine = NULL;
+    for (Scope *s = GetEnclosingScope(); s && !mine; s = s->GetEnclosing()) {
+        mine = s->Lookup(idToFind);
+        depth++;
+    }
+    TraceEvent(kTraceLookup, 'i', idToFind->GetName(), depth, mine != NULL);
+    return mine;
+}
+
+Identifier::Identifier(yyltype loc, Symbol *n) : Node(loc) {
+    Assert(n != NULL);
+    kind = kIdentifier;
+    name = n;
+    cached = NULL;
+    resolved = false;
+} 
+
 Identifier::Identifier(yyltype loc, const char *n) : Node(loc) {
-    name = strdup(n);
+    kind = kIdentifier;
+    name = Symbol::Intern(n);
     cached = NULL;
+    resolved = false;
 } 
 
+static std::atomic<int> numBound(0), numCacheHits(0);
+
+Decl *Identifier::GetDecl() {
+    if (resolved) {
+        numCacheHits++;
+        return cached;
+    }
+    cached = FindDecl(this);
+    resolved = true;
+    numBound++;
+    return cached;
+}
+
+void Identifier::PrintResolveStats() {
+    PrintDebug(kTraceResolve, "%d identifier uses bound, %d lookups answered from the binding cache",
+               (int)numBound, (int)numCacheHits);
+}
+
@@ -10,6 +10,10 @@
  * file), that location can be NULL for those nodes that don't care/use 
  * locations. The location is typcially set by the node constructor.  The 
  * location is used to provide the context when reporting semantic errors.
+ * The location is stored inside the node itself, GetLocation hands out a
+ * pointer to it (or NULL if the node was constructed without one). When
+ * an edit adds or removes lines ahead of a node that is kept (see
+ * server.h), its location is moved along the next time it is asked for.
  *
  * Parent: Each node has a pointer to its parent. For a Program node, the 
  * parent is NULL, for all other nodes it is the pointer to the node one level
@@ -18,7 +22,27 @@
  * instead we wait until assigning the children into the parent node and then 
  * set up links in both directions. The parent link is typically not used 
  * during parsing, but is more important in later phases.
-
+ *
+ * Scopes: Only a few kinds of nodes (Program, class, interface, function
+ * bodies and statement blocks) own a scope, each scope links to the one
+ * enclosing it. A node finds its innermost scope by climbing parents the
+ * first time it is asked and remembers the owning node after that, so a
+ * lookup from deep inside an expression walks just the scope chain.
+ *
+ * Kind: Each node records which concrete class it is, set by that
+ * class's constructor, so the checker can test for and convert to a node
+ * class with isa, cast and dyn_cast (below) instead of dynamic_cast. The
+ * kinds of the subclasses of each abstract class are numbered one after
+ * the other, testing for Decl or Expr is a compare against a range.
+ *
+ * Allocation: Nodes are allocated from the tree arena (see arena.h) rather
+ * than the heap. They are never deleted one by one, the whole tree goes
+ * away at once when the arena is released, at exit (or after each file
+ * in batch mode).
+ *
+ * Caching: The tree can be saved to a file and read back in place of
+ * parsing (see astcache.h). The node classes whose fields that needs to
+ * get at make AstCache a friend.
  */
 
 #ifndef _H_ast
@@ -26,6 +50,9 @@
 
 #include <stdlib.h>   // for NULL
 #include "location.h"
+#include "arena.h"
+#include "symbol.h"
+#include "utility.h"
 #include <iostream>
 class Scope;
 class Decl;
@@ -34,37 +61,100 @@ class Type;
 
 class Node 
 {
+  public:
+    enum Kind {
+        kOther, kIdentifier, kOperator, kProgram,
+        kVarDecl, kFnDecl, kClassDecl, kInterfaceDecl,
+        kStmtBlock, kIfStmt, kForStmt, kWhileStmt, kBreakStmt, kReturnStmt,
+        kPrintStmt, kSwitchStmt, kCaseStmt,
+        kEmptyExpr, kIntConstant, kDoubleConstant, kBoolConstant,
+        kStringConstant, kNullConstant,
+        kArithmeticExpr, kRelationalExpr, kEqualityExpr, kLogicalExpr, kAssignExpr,
+        kThis, kArrayAccess, kFieldAccess, kPostfix, kCall, kNewExpr,
+        kNewArrayExpr, kReadIntegerExpr, kReadLineExpr,
+        kType, kNamedType, kArrayType
+    };
+
   protected:
-    yyltype *location;
+    yyltype location;
+    bool hasLocation;
+    unsigned char kind;
+    unsigned int shiftsSeen;  // how many ShiftLines the location reflects
     Node *parent;
     Scope *nodeScope;
+    Node *scopeOwner;  // innermost node at or above this one owning a scope
 
   public:
     Node(yyltype loc);
     Node();
+
+    static void *operator new(size_t size) { return TreeArena().Alloc(size, Arena::kNode); }
+    static void operator delete(void *) {} // released along with the arena
     
-    yyltype *GetLocation()   { return location; }
-    void SetParent(Node *p)  { parent = p; }
+    yyltype *GetLocation()   { if (shiftsSeen != numShifts) ApplyShifts();
+                               return hasLocation ? &location : NULL; }
+    void SetParent(Node *p)  { parent = p; scopeOwner = NULL; }
     Node *GetParent()        { return parent; }
+    Kind GetKind()           { return (Kind)kind; }
     virtual void Check() {} // not abstract, since some nodes have nothing to do
     
     typedef enum { kShallow, kDeep } lookup;
     virtual Decl *FindDecl(Identifier *id, lookup l = kDeep);
     virtual Scope *PrepareScope() { return NULL; }
+    virtual bool OwnsScope() { return false; }
+    Scope *GetEnclosingScope();
+
+        // Moves the location of every node existing now down by delta
+        // lines wherever it is past line afterLine. ForgetShifts starts
+        // over, for a new tree.
+    static void ShiftLines(int afterLine, int delta);
+    static void ForgetShifts();
+
+  private:
+    static unsigned int numShifts;
+    void ApplyShifts();
 };
+
+
+/* Function: isa, cast, dyn_cast
+ * -----------------------------
+ * Whether a node is of class T, and the node as a T, going by the kind
+ * the node was made with. Each class tested for has a classof saying
+ * which kinds belong to it. A NULL node is of no class. Cast is for a
+ * node known to be a T, dyn_cast returns NULL if it is not one.
+ */
+template <class T> inline bool isa(Node *n)
+    { return n && T::classof(n); }
+
+template <class T> inline T *cast(Node *n)
+    { DebugAssert(!n || isa<T>(n)); return static_cast<T*>(n); }
+
+template <class T> inline T *dyn_cast(Node *n)
+    { return isa<T>(n) ? static_cast<T*>(n) : NULL; }
    
 
+/* An identifier used in an expression is bound to the declaration it
+ * names the first time GetDecl is called, by looking the name up from
+ * the identifier's place in the tree. The binding is kept in cached so
+ * every later query for the same use is answered without a lookup.
+ * With -d resolve, counts of bindings and cache hits are printed at the
+ * end (see PrintResolveStats). */
 class Identifier : public Node 
 {
   protected:
-    char *name;
+    Symbol *name;
     Decl *cached;
+    bool resolved;
     
   public:
+    Identifier(yyltype loc, Symbol *name);
     Identifier(yyltype loc, const char *name);
     virtual bool IsIdentifier(){return true;}
-    friend std::ostream& operator<<(std::ostream& out, Identifier *id) { return out << id->name; }
-    const char *GetName() { return name; }
+    friend std::ostream& operator<<(std::ostream& out, Identifier *id) { return out << id->GetName(); }
+    const char *GetName() { return name->GetName(); }
+    Symbol *GetSymbol() { return name; }
+    Decl *GetDecl();
+    static void PrintResolveStats();
 };
 
 
@@ -20,6 +20,7 @@ bool Decl::ConflictsWithPrevious(Decl *prev) {
 }
 
 VarDecl::VarDecl(Identifier *n, Type *t) : Decl(n) {
+    kind = kVarDecl;
     Assert(n != NULL && t != NULL);
     (type=t)->SetParent(this);
 }
@@ -35,6 +36,7 @@ void VarDecl::Check() {
 }
 
 ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<Decl*> *m) : Decl(n) {
+    kind = kClassDecl;
     // extends can be NULL, impl & mem may be empty lists but cannot be NULL
     Assert(n != NULL && imp != NULL && m != NULL);     
     extends = ex;
@@ -44,10 +46,15 @@ ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<D
     cType = new NamedType(n);
     cType->SetParent(this);
     convImp = NULL;
+    scopeComplete = false;
 }
 
 void ClassDecl::Check() {
+    PrepareCheck();
+    CheckBody();
+}
 
+void ClassDecl::PrepareCheck() {
     if (extends && !extends->IsClass()) {
         ReportError::IdentifierNotDeclared(extends->GetId(), LookingForClass);
         extends = NULL;
@@ -60,54 +67,72 @@ void ClassDecl::Check() {
         }
     }
     PrepareScope();
+}
+
+void ClassDecl::CheckBody() {
     members->CheckAll();
 }
 
-// This is not done very cleanly. I should sit down and sort this out. Right now
-// I was using the copy-in strategy from the old compiler, but I think the link to
-// parent may be the better way now.
+// The scope of the superclass and those of the interfaces are layered under
+// this class's own scope rather than copied into it (see scope.h). A superclass
+// whose scope is still being prepared is part of an inheritance cycle and
+// contributes nothing, it has no members declared yet.
 Scope *ClassDecl::PrepareScope()
 {
     if (nodeScope) return nodeScope;
-    nodeScope = new Scope();  
+    nodeScope = new Scope(parent->GetEnclosingScope());
     if (extends) {
-        ClassDecl *ext = dynamic_cast<ClassDecl*>(parent->FindDecl(extends->GetId())); 
-        if (ext) nodeScope->CopyFromScope(ext->PrepareScope(), this);
+        ClassDecl *ext = dyn_cast<ClassDecl>(parent->FindDecl(extends->GetId())); 
+        if (ext) {
+            Scope *extScope = ext->PrepareScope();
+            if (ext->scopeComplete) nodeScope->Inherit(extScope);
+        }
     }
     convImp = new List<InterfaceDecl*>;
     for (int i = 0; i < implements->NumElements(); i++) {
         NamedType *in = implements->Nth(i);
-        InterfaceDecl *id = dynamic_cast<InterfaceDecl*>(in->FindDecl(in->GetId()));
+        InterfaceDecl *id = dyn_cast<InterfaceDecl>(in->FindDecl(in->GetId()));
         if (id) {
-		nodeScope->CopyFromScope(id->PrepareScope(), NULL);
+		nodeScope->Inherit(id->PrepareScope());
             convImp->Append(id);
 	  }
     }
     members->DeclareAll(nodeScope);
+    scopeComplete = true;
     return nodeScope;
 }
 
 
 
 InterfaceDecl::InterfaceDecl(Identifier *n, List<Decl*> *m) : Decl(n) {
+    kind = kInterfaceDecl;
     Assert(n != NULL && m != NULL);
     (members=m)->SetParentAll(this);
     id = n;
 }
 
 void InterfaceDecl::Check() {
+    PrepareCheck();
+    CheckBody();
+}
+
+void InterfaceDecl::PrepareCheck() {
     PrepareScope();
+}
+
+void InterfaceDecl::CheckBody() {
     members->CheckAll();
 }
   
 Scope *InterfaceDecl::PrepareScope() {
     if (nodeScope) return nodeScope;
-    nodeScope = new Scope();  
+    nodeScope = new Scope(parent->GetEnclosingScope());
     members->DeclareAll(nodeScope);
     return nodeScope;
 }
 	
 FnDecl::FnDecl(Identifier *n, Type *r, List<VarDecl*> *d) : Decl(n) {
+    kind = kFnDecl;
     Assert(n != NULL && r!= NULL && d != NULL);
     (returnType=r)->SetParent(this);
     (formals=d)->SetParentAll(this);
@@ -121,18 +146,26 @@ void FnDecl::SetFunctionBody(Stmt *b) {
 void FnDecl::Check() {
     returnType->Check();
     if (body) {
-        nodeScope = new Scope();
-        formals->DeclareAll(nodeScope);
+        PrepareScope();
         formals->CheckAll();
 	body->Check();
     // printf("check FnDecl\n");
     }
 }
 
+// Only a function with a body gets a scope for its formals, those of a
+// prototype are never looked up.
+Scope *FnDecl::PrepareScope() {
+    if (nodeScope || !body) return nodeScope;
+    nodeScope = new Scope(parent->GetEnclosingScope());
+    formals->DeclareAll(nodeScope);
+    return nodeScope;
+}
+
 bool FnDecl::ConflictsWithPrevious(Decl *prev) {
  // special case error for method override
     if (IsMethodDecl() && prev->IsMethodDecl() && parent != prev->GetParent()) { 
-        if (!MatchesPrototype(dynamic_cast<FnDecl*>(prev))) {
+        if (!MatchesPrototype(cast<FnDecl>(prev))) {
             ReportError::OverrideMismatch(this);
             return true;
         }
@@ -143,7 +176,7 @@ bool FnDecl::ConflictsWithPrevious(Decl *prev) {
 }
 
 bool FnDecl::IsMethodDecl() 
-  { return dynamic_cast<ClassDecl*>(parent) != NULL || dynamic_cast<InterfaceDecl*>(parent) != NULL; }
+  { return isa<ClassDecl>(parent) || isa<InterfaceDecl>(parent); }
 
 bool FnDecl::MatchesPrototype(FnDecl *other) {
     if (!returnType->IsEquivalentTo(other->returnType)) return false;
@@ -30,15 +30,24 @@ class Decl : public Node
     friend std::ostream& operator<<(std::ostream& out, Decl *d) { return out << d->id; }
     Identifier *GetId() { return id; }
     const char *GetName() { return id->GetName(); }
+    Symbol *GetSymbol() { return id->GetSymbol(); }
     
     virtual bool ConflictsWithPrevious(Decl *prev);
+    static bool classof(Node *n)
+        { return n->GetKind() >= kVarDecl && n->GetKind() <= kInterfaceDecl; }
 
-    virtual bool IsVarDecl() { return false; } // jdz: could use typeid/dynamic_cast for these
-    virtual bool IsClassDecl() { return false; }
-    virtual bool IsInterfaceDecl() { return false; }
-    virtual bool IsFnDecl() { return false; } 
+    bool IsVarDecl() { return kind == kVarDecl; }
+    bool IsClassDecl() { return kind == kClassDecl; }
+    bool IsInterfaceDecl() { return kind == kInterfaceDecl; }
+    bool IsFnDecl() { return kind == kFnDecl; }
     virtual bool IsMethodDecl() { return false; }
     virtual void Check() = 0;
+
+        // A top-level decl can also be checked in two steps (see
+        // Program::Check). PrepareCheck builds what other decls may
+        // depend on, like the class scopes, CheckBody does the rest.
+    virtual void PrepareCheck() {}
+    virtual void CheckBody() { Check(); }
 };
 
 class VarDecl : public Decl 
@@ -48,39 +57,50 @@ class VarDecl : public Decl
     
   public:
     VarDecl(Identifier *name, Type *type);
+    static bool classof(Node *n) { return n->GetKind() == kVarDecl; }
     void Check();
     Type *GetDeclaredType() { return type; }
 };
 
 class ClassDecl : public Decl 
 {
+  friend class AstCache;
   protected:
     List<Decl*> *members;
     // NamedType *extends;  
     List<NamedType*> *implements;
     Type *cType;
     List<InterfaceDecl*> *convImp;
+    bool scopeComplete;
 
   public:
     NamedType *extends;
     ClassDecl(Identifier *name, NamedType *extends, 
               List<NamedType*> *implements, List<Decl*> *members);
     void Check();
-    // bool IsClassDecl() { return true; }
+    void PrepareCheck();
+    void CheckBody();
+    static bool classof(Node *n) { return n->GetKind() == kClassDecl; }
+    List<Decl*> *GetMembers() { return members; }
     Scope *PrepareScope();
+    bool OwnsScope() { return true; }
 };
 
 class InterfaceDecl : public Decl 
 {
+  friend class AstCache;
   protected:
     List<Decl*> *members;
     
   public:
     Identifier *id;
     InterfaceDecl(Identifier *name, List<Decl*> *members);
+    static bool classof(Node *n) { return n->GetKind() == kInterfaceDecl; }
     void Check();
-    // bool IsInterfaceDecl() { return true; }
+    void PrepareCheck();
+    void CheckBody();
     Scope *PrepareScope();
+    bool OwnsScope() { return true; }
 };
 
 class FnDecl : public Decl 
@@ -94,12 +114,15 @@ class FnDecl : public Decl
     List<VarDecl*> *formals;
     Type *returnType;
     FnDecl(Identifier *name, Type *returnType, List<VarDecl*> *formals);
+    static bool classof(Node *n) { return n->GetKind() == kFnDecl; }
     void SetFunctionBody(Stmt *b);
+    Stmt *GetBody() { return body; }
     void Check();
-    // bool IsFnDecl() { return true; }
     bool IsMethodDecl();
     bool ConflictsWithPrevious(Decl *prev);
     bool MatchesPrototype(FnDecl *other);
+    Scope *PrepareScope();
+    bool OwnsScope() { return body != NULL; }
 };
 
 #endif
@@ -5,30 +5,38 @@
 #include "ast_expr.h"
 #include "ast_type.h"
 #include "ast_decl.h"
+#include "scope.h"
 #include <string.h>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 using namespace std;
 
 #include "errors.h"
 
 IntConstant::IntConstant(yyltype loc, int val) : Expr(loc) {
+    kind = kIntConstant;
     value = val;
 }
 
 DoubleConstant::DoubleConstant(yyltype loc, double val) : Expr(loc) {
+    kind = kDoubleConstant;
     value = val;
 }
 
 BoolConstant::BoolConstant(yyltype loc, bool val) : Expr(loc) {
+    kind = kBoolConstant;
     value = val;
 }
 
 StringConstant::StringConstant(yyltype loc, const char *val) : Expr(loc) {
+    kind = kStringConstant;
     Assert(val != NULL);
     value = strdup(val);
 }
 
 Operator::Operator(yyltype loc, const char *tok) : Node(loc) {
+    kind = kOperator;
     Assert(tok != NULL);
     strncpy(tokenString, tok, sizeof(tokenString));
 }
@@ -49,7 +57,7 @@ CompoundExpr::CompoundExpr(Operator *o, Expr *r)
     (right=r)->SetParent(this);
 }
 
-Type* CompoundExpr::GetType(){
+Type* CompoundExpr::ComputeType(){
     if(left){
         return left->GetType();
     }
@@ -66,7 +74,7 @@ void CompoundExpr::Check(){
 
 }
 
-Type* ArithmeticExpr::GetType(){
+Type* ArithmeticExpr::ComputeType(){
     if(left && right){
         Type* l = left->GetType();
         Type* r = right->GetType();
@@ -110,7 +118,7 @@ void ArithmeticExpr::Check(){
 
     
 }
-Type* RelationalExpr::GetType(){
+Type* RelationalExpr::ComputeType(){
     Type* l = left->GetType();
     Type* r = right->GetType();
     if(l->IsEquivalentTo(Type::intType) && r->IsEquivalentTo(Type::intType))
@@ -130,7 +138,7 @@ void RelationalExpr::Check(){
     ReportError::IncompatibleOperands(op, l, r);
 }
 
-Type* EqualityExpr::GetType(){
+Type* EqualityExpr::ComputeType(){
     Type* l = left->GetType();
     Type* r = right->GetType();
     if (l->IsEquivalentTo(r) || r->IsEquivalentTo(l)){
@@ -150,7 +158,7 @@ void EqualityExpr::Check(){
         ReportError::IncompatibleOperands(op, l, r);
 }
 
-Type* LogicalExpr::GetType(){
+Type* LogicalExpr::ComputeType(){
     Type* r = right->GetType();
     if(left==NULL){
         if (r->IsEquivalentTo(Type::boolType)){
@@ -185,61 +193,45 @@ void LogicalExpr::Check(){
     ReportError::IncompatibleOperands(op,l,r);
 }
 
-Type* AssignExpr::GetType(){
+Type* AssignExpr::ComputeType(){
     Type* l = left->GetType();
     Type* r = right->GetType();
 
     if (l->IsEquivalentTo(r)){
         return l;
     }
-    else{
-        ReportError::IncompatibleOperands(op,l,r);
-        return Type::errorType;
-    }
-    
+    return Type::errorType;
 }  
 void AssignExpr::Check(){
     // printf("%s:%d\n", __PRETTY_FUNCTION__, __LINE__);
         left->Check();
         right->Check();
-    Type* ae = this->GetType();
-    if (!ae->IsEquivalentTo(Type::errorType)){
-        return;
+    Type* l = left->GetType();
+    Type* r = right->GetType();
+    if (!l->IsEquivalentTo(r)){
+        ReportError::IncompatibleOperands(op,l,r);
     }
-
-    // Type* l = left->GetType();
-    // Type* r = right->GetType();
-    // if (l->IsEquivalentTo(r)){
-    //     return;
-    // }
-    
 }
 
-Decl* This::GetClass(){
-    Node *n = this;
-    while(n){
-        ClassDecl* cd = dynamic_cast<ClassDecl*>(n);
-        if (cd){
-            return cd;
-        }
+// The class whose body the node is in, NULL outside of any class.
+static ClassDecl *EnclosingClass(Node *n) {
+    while (n && !isa<ClassDecl>(n))
         n = n->GetParent();
-    } 
+    return cast<ClassDecl>(n);
+}
 
-    return NULL;
+Decl* This::GetClass(){
+    return EnclosingClass(this);
 }
 
-Type* This::GetType(){
-    ClassDecl* cd = dynamic_cast<ClassDecl*>(this->GetClass());
-    if (cd){
-        // Decl* d = dynamic_cast<Decl*>(cd);
-        // return new NamedType(d->id);
-        return cd->extends;
-    }
-    ReportError::ThisOutsideClassScope(this);
+Type* This::ComputeType(){
+    ClassDecl* cd = cast<ClassDecl>(this->GetClass());
+    if (cd)
+        return NamedType::Canonical(cd->GetSymbol());
     return Type::errorType;
 }  
 void This::Check(){
-    ClassDecl* cd = dynamic_cast<ClassDecl*>(this->GetClass());
+    ClassDecl* cd = cast<ClassDecl>(this->GetClass());
     if (cd){
         return;
     }
@@ -247,12 +239,13 @@ void This::Check(){
     
 }
 ArrayAccess::ArrayAccess(yyltype loc, Expr *b, Expr *s) : LValue(loc) {
+    kind = kArrayAccess;
     (base=b)->SetParent(this); 
     (subscript=s)->SetParent(this);
 }
 
-Type* ArrayAccess::GetType() {
-    ArrayType* at = dynamic_cast<ArrayType*>(base->GetType());
+Type* ArrayAccess::ComputeType() {
+    ArrayType* at = dyn_cast<ArrayType>(base->GetType());
     if (at!= NULL){
         return at->GetElemType();
     }
@@ -262,7 +255,7 @@ Type* ArrayAccess::GetType() {
 void ArrayAccess::Check() {
     base->Check();
     subscript->Check();
-    ArrayType* at = dynamic_cast<ArrayType*>(base->GetType());
+    ArrayType* at = dyn_cast<ArrayType>(base->GetType());
     Type* st = subscript->GetType();
     Type* e = Type::errorType;
     if(at == NULL){
@@ -276,94 +269,92 @@ void ArrayAccess::Check() {
      
 FieldAccess::FieldAccess(Expr *b, Identifier *f) 
   : LValue(b? Join(b->GetLocation(), f->GetLocation()) : *f->GetLocation()) {
+    kind = kFieldAccess;
     Assert(f != NULL); // b can be be NULL (just means no explicit base)
     base = b; 
     if (base) base->SetParent(this); 
     (field=f)->SetParent(this);
 }
 
+// The class a type names, NULL if it is not a class type. The canonical
+// types are in no tree, so the name is looked up in the global scope,
+// where every class is declared, starting from the node using the type.
+static ClassDecl *ClassOfType(Node *from, Type *t) {
+    NamedType *nt = dyn_cast<NamedType>(t);
+    if (nt == NULL) return NULL;
+    Scope *s = from->GetEnclosingScope();
+    while (s && s->GetEnclosing())
+        s = s->GetEnclosing();
+    return s ? dyn_cast<ClassDecl>(s->Lookup(nt->GetId())) : NULL;
+}
+
+// Whether c is base or derives from it. A cycle of extends was reported
+// when the classes were prepared, the walk stops when it comes around.
+static bool IsSubclassOf(ClassDecl *c, ClassDecl *base) {
+    std::vector<ClassDecl*> seen;
+    while (c && c != base) {
+        if (std::find(seen.begin(), seen.end(), c) != seen.end())
+            return false;
+        seen.push_back(c);
+        c = c->extends ? dyn_cast<ClassDecl>(c->extends->GetDeclForType()) : NULL;
+    }
+    return c != NULL;
+}
+
+/* Method: FindField
+ * -----------------
+ * The member named after the dot, looked up in the class of the base and
+ * what it inherits, NULL if the base is not of a class type or the class
+ * has no such member.
+ */
+Decl *FieldAccess::FindField() {
+    ClassDecl *cd = ClassOfType(this, base->GetType());
+    return cd ? cd->PrepareScope()->Lookup(field) : NULL;
+}
+
+// A field of an object is only accessible from within its class or a
+// subclass of it, like this.x or other.x in a method of the class.
 void FieldAccess::Check(){
-    if (base){
-        base->Check();
-    }    
-    Decl *d = FindDecl(field);
-    ClassDecl* cd = dynamic_cast<ClassDecl*>(d);
-    NamedType* nt;
-    Type* t;
     if (base == NULL){
-        if (cd == NULL){
-            if (d == NULL){
-                ReportError::IdentifierNotDeclared(field, LookingForVariable);
-                return;
-            }
-        }
-        else{
-            nt = new NamedType(d->GetId());
-            d = FindDecl(field);
-            if (d == NULL){
-                ReportError::FieldNotFoundInBase(field, nt);
-                return;
-            }
-        }
+        if (!isa<VarDecl>(field->GetDecl()))
+            ReportError::IdentifierNotDeclared(field, LookingForVariable);
+        return;
     }
-    else{
-        t = base->GetType();
-        d = FindDecl(field);
-        if (d==NULL){
-            ReportError::FieldNotFoundInBase(field, t);
-            return;
-        }
-        else if(cd == NULL){
-            ReportError::InaccessibleField(field, t);
-            return;
-        }
+    base->Check();
+    Type *t = base->GetType();
+    if (t == Type::errorType)   // already reported
+        return;
+    if (!isa<VarDecl>(FindField())){
+        ReportError::FieldNotFoundInBase(field, t);
+        return;
     }
-    if(dynamic_cast<VarDecl*>(d) == NULL)
-        ReportError::InaccessibleField(field,base->GetType());
+    ClassDecl *within = EnclosingClass(this);
+    if (within == NULL || !IsSubclassOf(within, ClassOfType(this, t)))
+        ReportError::InaccessibleField(field, t);
 }
 
-Type* FieldAccess::GetType(){
-    Decl *d;
-    NamedType *nt;
-    if (base==NULL){  // si no hay base
-        d = FindDecl(field); //busca declaracion
-        if (dynamic_cast<VarDecl*>(d)!=NULL){ // si es una variable
-            return dynamic_cast<VarDecl*>(d)->GetDeclaredType(); // el tipo d la decl
-        }
-        else if(dynamic_cast<ClassDecl*>(d)){ // si es una clase 
-            nt = dynamic_cast<ClassDecl*>(d)->extends;
-            return nt;
-        }
-        else if(dynamic_cast<FnDecl*>(d)!=NULL){
-            return dynamic_cast<FnDecl*>(d)->returnType;
-        }
-    }
-    else{ // si hay base
-        d = FindDecl(field); // buscar decl de field
-        // dynamic_cast<VarDecl*>(d)->GetDeclaredType(); // obtener el tipo
-        // return base->GetType(); // regresa el tipo de la base
-    }
-    if(d==NULL || dynamic_cast<VarDecl*>(d)==NULL)
+Type* FieldAccess::ComputeType(){
+    // a name that is not a variable has no type, Check reports it
+    Decl *d = base ? FindField() : field->GetDecl();
+    if(!isa<VarDecl>(d))
         return Type::errorType;
-    return dynamic_cast<VarDecl*>(d)->GetDeclaredType();
-
-    // Decl *d;
-    // ClassDecl* cd = GetClassDecl(scope);
-    // return Type::intType;
+    return cast<VarDecl>(d)->GetDeclaredType();
 }
 
   Postfix::Postfix(Operator *o, Expr *ex):LValue(*ex->GetLocation()){
+    kind = kPostfix;
     (op=o)->SetParent(this);
     (right=ex)->SetParent(this);
   }
 
 
-Type* Postfix::GetType(){
+Type* Postfix::ComputeType(){
     return Type::errorType;
 }  
 
 
 Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
+    kind = kCall;
     Assert(f != NULL && a != NULL); // b can be be NULL (just means no explicit base)
     base = b;
     if (base) base->SetParent(this);
@@ -371,16 +362,16 @@ Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
     (actuals=a)->SetParentAll(this);
 }
 
-Type* Call::GetType(){
+Type* Call::ComputeType(){
     Decl* d;
     ClassDecl* cd;
     NamedType* nt;
     Type* t;
-    d = FindDecl(field);
+    d = field->GetDecl();
     if (base==NULL){
-        cd = dynamic_cast<ClassDecl*>(d);
+        cd = dyn_cast<ClassDecl>(d);
         if (cd==NULL){
-            d = FindDecl(field);
+            d = field->GetDecl();
         }
         // else{
         //     d = FindDecl(field);
@@ -389,20 +380,22 @@ Type* Call::GetType(){
     }
     else{
         t = base->GetType();
-        d = FindDecl(field);
-        if(d==NULL && dynamic_cast<ArrayType*>(t)!=NULL && strcmp(field->GetName(), "length")==0)
+        d = field->GetDecl();
+        if(d==NULL && isa<ArrayType>(t) && strcmp(field->GetName(), "length")==0)
             return Type::intType;
     }
-    if (d==NULL || dynamic_cast<FnDecl*>(d)==NULL){
+    if (!isa<FnDecl>(d)){
         return Type::errorType;
     }
-    return dynamic_cast<FnDecl*>(d)->returnType;
+    return cast<FnDecl>(d)->returnType;
     
         
 }
 void Call::ValidateActuals(){
-    Decl* d = FindDecl(field);
-    List<VarDecl*> *formals = dynamic_cast<FnDecl*>(d)->formals;//aqui
+    FnDecl* fn = dyn_cast<FnDecl>(field->GetDecl());
+    if (fn == NULL)     // not a function, Check has said so
+        return;
+    List<VarDecl*> *formals = fn->formals;
     int numFormals = formals->NumElements();
     int numActuals = actuals->NumElements();
     if (numActuals != numFormals){
@@ -426,30 +419,19 @@ void Call::Check(){
     }
     
     Decl* d;
-    ClassDecl* cd = dynamic_cast<ClassDecl*>(this);
     Type* t;
     if (base ==NULL){
-        if (cd==NULL){
-            d=FindDecl(field);
-            if (d==NULL){
-                ReportError::IdentifierNotDeclared(field, LookingForFunction);
-                return;
-            }
-        }    
-        else{
-            t = base->GetType();
-            d = FindDecl(field);
-            if (d== NULL){
-                ReportError::IdentifierNotDeclared(field, LookingForFunction);
-                return;
-            }
+        d=field->GetDecl();
+        if (d==NULL){
+            ReportError::IdentifierNotDeclared(field, LookingForFunction);
+            return;
         }
     }
     else{
         t = base->GetType();
-        d = FindDecl(field);
+        d = field->GetDecl();
         if (d ==NULL){
-            if(dynamic_cast<ArrayType*>(t)!=NULL){
+            if(isa<ArrayType>(t)){
                 return;
             }
             ReportError::FieldNotFoundInBase(field,t);
@@ -460,7 +442,7 @@ void Call::Check(){
     if(actuals->NumElements()){
         ValidateActuals();
     }
-    FnDecl* fd = dynamic_cast<FnDecl*>(d);
+    FnDecl* fd = dyn_cast<FnDecl>(d);
     if (fd==NULL){
         return;
     }
@@ -469,11 +451,12 @@ void Call::Check(){
 
 
 NewExpr::NewExpr(yyltype loc, NamedType *c) : Expr(loc) { 
+  kind = kNewExpr;
   Assert(c != NULL);
   (cType=c)->SetParent(this);
 }
 
-Type* NewExpr::GetType(){
+Type* NewExpr::ComputeType(){
     return Type::errorType;
 }  
 void NewExpr::Check(){
@@ -481,34 +464,26 @@ void NewExpr::Check(){
 }
 
 NewArrayExpr::NewArrayExpr(yyltype loc, Expr *sz, Type *et) : Expr(loc) {
+    kind = kNewArrayExpr;
     Assert(sz != NULL && et != NULL);
     (size=sz)->SetParent(this); 
     (elemType=et)->SetParent(this);
 }
 
-Type* NewArrayExpr::GetType(){
-    // printf("%s:%d\n", __PRETTY_FUNCTION__, __LINE__);
-
-    if (!size->GetType()->IsEquivalentTo(Type::intType)){
-        ReportError::NewArraySizeNotInteger(size);
-    }
-    if(dynamic_cast<NamedType*>(elemType)){
-        if (!elemType->IsPrimitiveType() && !elemType->IsEquivalentTo(Type::voidType)){
-        return new ArrayType(elemType);
-        }
-    }
-    return new ArrayType(elemType);
+Type* NewArrayExpr::ComputeType(){
+    return ArrayType::Canonical(elemType);
 }
 
 void NewArrayExpr::Check(){
     // printf("%s:%d\n", __PRETTY_FUNCTION__, __LINE__);
-    GetType(); // get type incluye lo de check
-
+    if (!size->GetType()->IsEquivalentTo(Type::intType)){
+        ReportError::NewArraySizeNotInteger(size);
+    }
 }
-Type* ReadLineExpr::GetType(){
+Type* ReadLineExpr::ComputeType(){
     return Type::errorType;
 }   
-Type* ReadIntegerExpr::GetType(){
+Type* ReadIntegerExpr::ComputeType(){
     return Type::errorType;
 }
 
@@ -22,13 +22,27 @@ class Type; // for NewArray
 class Identifier;
 
 
+/* The type of an expression is computed once, the first time GetType is
+ * asked for it, and kept in the type slot from then on (even when it came
+ * out NULL). Subclasses supply the computation in ComputeType, which
+ * should only ever be reached through GetType so that each node does the
+ * work a single time. ComputeType only works the type out, the errors
+ * are reported by Check, so asking for a type never reports anything. */
 class Expr : public Stmt 
 {
-  public:
-    Expr(yyltype loc) : Stmt(loc) {}
-    Expr() : Stmt() {}
+  protected:
+    Type *type;
+    bool typeComputed;
 
-    virtual Type* GetType() = 0;
+  public:
+    Expr(yyltype loc) : Stmt(loc) { type = NULL; typeComputed = false; }
+    Expr() : Stmt() { type = NULL; typeComputed = false; }
+
+    Type* GetType() {
+        if (!typeComputed) { type = ComputeType(); typeComputed = true; }
+        return type;
+    }
+    virtual Type* ComputeType() = 0;
     virtual void Check() {};
 
     // virtual ~Expr(){};
@@ -49,60 +63,65 @@ class Expr : public Stmt
 class EmptyExpr : public Expr
 {
   public:
-    Type* GetType(){ return Type::errorType; } //nullType; }  
+    EmptyExpr() : Expr() { kind = kEmptyExpr; }
+    Type* ComputeType(){ return Type::errorType; } //nullType; }  
 
 };
 
 class IntConstant : public Expr 
 {
+  friend class AstCache;
   protected:
     int value;
   
   public:
     IntConstant(yyltype loc, int val);
     // virtual bool IsIntConstant(){ return true;}
-    Type* GetType(){ return Type::intType; }
+    Type* ComputeType(){ return Type::intType; }
 };
 
 class DoubleConstant : public Expr 
 {
+  friend class AstCache;
   protected:
     double value;
     
   public:
     DoubleConstant(yyltype loc, double val);
     // virtual bool IsDoubleConstant(){ return true; }
-    Type* GetType(){ return Type::doubleType; }
+    Type* ComputeType(){ return Type::doubleType; }
 };
 
 class BoolConstant : public Expr 
 {
+  friend class AstCache;
   protected:
     bool value;
     
   public:
     BoolConstant(yyltype loc, bool val);
     // virtual bool IsBoolConstant(){ return true; }
-    Type* GetType(){ return Type::boolType;}
+    Type* ComputeType(){ return Type::boolType;}
 };
 
 class StringConstant : public Expr 
 { 
+  friend class AstCache;
   protected:
     char *value;
     
   public:
     StringConstant(yyltype loc, const char *val);
     // virtual bool IsStringConstant(){ return true; }
-    Type* GetType(){ return Type::stringType; }
+    Type* ComputeType(){ return Type::stringType; }
 };
 
 class NullConstant: public Expr 
 {
   public: 
-    NullConstant(yyltype loc) : Expr(loc) {}
+    NullConstant(yyltype loc) : Expr(loc) { kind = kNullConstant; }
     // virtual bool IsNullConstant(){ return true; }
-    Type* GetType(){return Type::nullType; }
+    Type* ComputeType(){return Type::nullType; }
 };
 
 class Operator : public Node 
@@ -118,6 +137,7 @@ class Operator : public Node
  
 class CompoundExpr : public Expr
 {
+  friend class AstCache;
   protected:
     Operator *op;
     Expr *left, *right; // left will be NULL if unary
@@ -125,53 +145,53 @@ class CompoundExpr : public Expr
   public:
     CompoundExpr(Expr *lhs, Operator *op, Expr *rhs); // for binary
     CompoundExpr(Operator *op, Expr *rhs);             // for unary
-    virtual Type* GetType();
+    virtual Type* ComputeType();
     virtual void Check(); 
 };
 
 class ArithmeticExpr : public CompoundExpr 
 {
   public:
-    ArithmeticExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
-    ArithmeticExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
+    ArithmeticExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) { kind = kArithmeticExpr; }
+    ArithmeticExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) { kind = kArithmeticExpr; }
     void Check();
-    Type* GetType();
+    Type* ComputeType();
 };
 
 class RelationalExpr : public CompoundExpr 
 {
   public:
-    RelationalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
+    RelationalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) { kind = kRelationalExpr; }
     void Check();
-    Type* GetType();
+    Type* ComputeType();
 };
 
 class EqualityExpr : public CompoundExpr 
 {
   public:
-    EqualityExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
+    EqualityExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) { kind = kEqualityExpr; }
     const char *GetPrintNameForNode() { return "EqualityExpr"; }
     void Check();
-    Type* GetType();
+    Type* ComputeType();
 };
 
 class LogicalExpr : public CompoundExpr 
 {
   public:
-    LogicalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
-    LogicalExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
+    LogicalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) { kind = kLogicalExpr; }
+    LogicalExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) { kind = kLogicalExpr; }
     const char *GetPrintNameForNode() { return "LogicalExpr"; }
     void Check();
-    Type* GetType();
+    Type* ComputeType();
 };
 
 class AssignExpr : public CompoundExpr 
 {
   public:
-    AssignExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
+    AssignExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) { kind = kAssignExpr; }
     const char *GetPrintNameForNode() { return "AssignExpr"; }
     void Check();
-    Type* GetType();
+    Type* ComputeType();
 };
 
 class LValue : public Expr 
@@ -183,20 +203,21 @@ class LValue : public Expr
 class This : public Expr 
 {
   public:
-    This(yyltype loc) : Expr(loc) {}
+    This(yyltype loc) : Expr(loc) { kind = kThis; }
     void Check();
-    Type* GetType();
+    Type* ComputeType();
     Decl *GetClass();
 };
 
 class ArrayAccess : public LValue 
 {
+  friend class AstCache;
   protected:
     Expr *base, *subscript;
     
   public:
     ArrayAccess(yyltype loc, Expr *base, Expr *subscript);
-    Type* GetType();
+    Type* ComputeType();
     void Check();
 };
 
@@ -207,6 +228,7 @@ class ArrayAccess : public LValue
  * and sort it out later. */
 class FieldAccess : public LValue 
 {
+  friend class AstCache;
   // protected:
     Expr *base;	// will be NULL if no explicit base
     Identifier *field;
@@ -217,11 +239,13 @@ class FieldAccess : public LValue
     FieldAccess(Expr *base, Identifier *field); //ok to pass NULL base
     // virtual bool IsFieldAccess(){ return true; }
     void Check();
-    Type* GetType();
+    Type* ComputeType();
+    Decl *FindField();
 };
 
 /* Class for postfix expressions */
 class Postfix : public LValue{
+  friend class AstCache;
   protected:
     Operator *op;
     Expr *right;
@@ -229,7 +253,7 @@ class Postfix : public LValue{
     Postfix(Operator *op, Expr *rhs);
     const char *GetPrintNameForNode() {return "Postfix";}
     void PrintChildren(int indentLevel);
-    Type* GetType();
+    Type* ComputeType();
 };
 
 /* Like field access, call is used both for qualified base.field()
@@ -238,6 +262,7 @@ class Postfix : public LValue{
  * and sort it out later. */
 class Call : public Expr 
 {
+  friend class AstCache;
   protected:
     Expr *base;	// will be NULL if no explicit base
     Identifier *field;
@@ -246,45 +271,47 @@ class Call : public Expr
   public:
     Call(yyltype loc, Expr *base, Identifier *field, List<Expr*> *args);
     void Check();
-    Type* GetType();
+    Type* ComputeType();
     void ValidateActuals();
 };
 
 class NewExpr : public Expr
 {
+  friend class AstCache;
   protected:
     NamedType *cType;
     
   public:
     NewExpr(yyltype loc, NamedType *clsType);
     void Check();
-    Type* GetType();
+    Type* ComputeType();
 };
 
 class NewArrayExpr : public Expr
 {
+  friend class AstCache;
   protected:
     Expr *size;
     Type *elemType;
     
   public:
     NewArrayExpr(yyltype loc, Expr *sizeExpr, Type *elemType);
-    Type* GetType();
+    Type* ComputeType();
     void Check();
 };
 
 class ReadIntegerExpr : public Expr
 {
   public:
-    ReadIntegerExpr(yyltype loc) : Expr(loc) {}
-    Type* GetType();
+    ReadIntegerExpr(yyltype loc) : Expr(loc) { kind = kReadIntegerExpr; }
+    Type* ComputeType();
 };
 
 class ReadLineExpr : public Expr
 {
   public:
-    ReadLineExpr(yyltype loc) : Expr (loc) {}
-    Type* GetType();
+    ReadLineExpr(yyltype loc) : Expr (loc) { kind = kReadLineExpr; }
+    Type* ComputeType();
 };
 
     
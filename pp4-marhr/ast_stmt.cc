@@ -7,36 +7,201 @@
 #include "ast_decl.h"
 #include "ast_expr.h"
 #include "scope.h"
+#include "trace.h"
 #include "errors.h"
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <time.h>
 using namespace std;
 
 
 Program::Program(List<Decl*> *d) {
+    kind = kProgram;
     Assert(d != NULL);
     (decls=d)->SetParentAll(this);
+    units = NULL;
 }
 
 void Program::Check() {
+    Check(NumJobs());
+}
+
+void Program::Check(int numThreads) {
+    Declare();
+    CheckBodies(numThreads);
+}
+
+
+/* Method: Declare
+ * ---------------
+ * Builds the global scope, then has each top-level decl do its
+ * PrepareCheck, one after the other in source order, which builds all
+ * the class and interface scopes. After that no decl changes anything
+ * another one looks at, so the bodies can be checked in any order. What
+ * is left is split into units the way the server does it (see server.cc):
+ * each top-level decl's body is one, except that a class has one for
+ * each of its members, so a big class can be spread over the threads
+ * too. The errors of each PrepareCheck and each unit are captured, and
+ * CheckBodies outputs them in source order, so the output is the same as
+ * checking each decl whole before going on to the next.
+ */
+void Program::Declare() {
+    GetEnclosingScope(); // builds the global scope and settles it as ours
+    units = new vector<CheckUnit>;
+    for (int i = 0; i < decls->NumElements(); i++) {
+        Decl *d = decls->Nth(i);
+        units->push_back(CheckUnit());
+        units->back().decl = NULL;
+        vector<ReportError::Message> *outer = ReportError::CaptureOutput(&units->back().errors);
+        d->PrepareCheck();
+        ReportError::CaptureOutput(outer);
+
+        ClassDecl *c = dyn_cast<ClassDecl>(d);
+        if (!c) {
+            units->push_back(CheckUnit());
+            units->back().decl = d;
+            continue;
+        }
+        c->GetEnclosingScope(); // settled now, its members all look it up
+        List<Decl*> *members = c->GetMembers();
+        for (int j = 0; j < members->NumElements(); j++) {
+            units->push_back(CheckUnit());
+            units->back().decl = members->Nth(j);
+        }
+    }
+}
+
+void Program::CheckBodies(int numThreads) {
+    Assert(units != NULL);
+    if (numThreads > 1 && units->size() > 1) {
+        CheckInParallel(numThreads);
+    } else {
+        for (size_t i = 0; i < units->size(); i++) {
+            CheckUnit &u = (*units)[i];
+            if (!u.decl) continue;
+            vector<ReportError::Message> *outer = ReportError::CaptureOutput(&u.errors);
+            u.decl->CheckBody();
+            ReportError::CaptureOutput(outer);
+        }
+    }
+    OutputErrors();
+}
+
+void Program::OutputErrors() {
+    if (!units) return;
+    for (size_t i = 0; i < units->size(); i++)
+        ReportError::OutputCaptured((*units)[i].errors);
+    delete units;
+    units = NULL;
+}
+
+
+/* Class: WorkRun
+ * --------------
+ * A run of units for one thread of CheckInParallel, those from front up
+ * to back. The thread it belongs to takes them from the front, the other
+ * threads steal from the back once their own run is done.
+ */
+class WorkRun
+{
+  public:
+    void Assign(int f, int b) { front = f; back = b; }
+    int TakeFront() { lock_guard<mutex> hold(lock); return front < back ? front++ : -1; }
+    int TakeBack() { lock_guard<mutex> hold(lock); return front < back ? --back : -1; }
+
+  private:
+    mutex lock;
+    int front, back;
+};
+
+static double ThreadSeconds()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+/* Method: CheckInParallel
+ * -----------------------
+ * Checks the units on the given number of threads by work stealing.
+ * Each thread starts out with an equal share of consecutive units, and
+ * when it is through them, takes units from the end of another thread's
+ * share, so the threads finish close together even when the units are
+ * far from equal in size. No units are added once the threads start, so
+ * a thread that finds nothing left to take anywhere is done. With
+ * -d passes, how many units each thread checked and the CPU time it took
+ * are printed.
+ */
+void Program::CheckInParallel(int numThreads) {
+    vector<int> work;
+    for (size_t i = 0; i < units->size(); i++)
+        if ((*units)[i].decl) work.push_back(i);
+    int n = work.size();
+    if (numThreads > n) numThreads = n;
+    vector<WorkRun> runs(numThreads);
+    for (int t = 0; t < numThreads; t++)
+        runs[t].Assign(t * n / numThreads, (t + 1) * n / numThreads);
+
+    TreeArena().SetLocking(true);
+    Scope::SetLocking(true);
+    vector<thread> workers;
+    for (int t = 0; t < numThreads; t++) {
+        workers.push_back(thread([&, t]() {
+            int done = 0;
+            for (int victim = 0; victim < numThreads; ) {
+                int w = victim ? runs[(t + victim) % numThreads].TakeBack()
+                               : runs[t].TakeFront();
+                if (w < 0) {
+                    victim++;
+                    continue;
+                }
+                CheckUnit &u = (*units)[work[w]];
+                ReportError::CaptureOutput(&u.errors);
+                u.decl->CheckBody();
+                done++;
+            }
+            ReportError::CaptureOutput(NULL);
+            PrintDebug(kTracePasses, "check thread %d: %d units in %.2f ms", t, done,
+                       ThreadSeconds() * 1000);
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    Scope::SetLocking(false);
+    TreeArena().SetLocking(false);
+}
+
+Scope *Program::PrepareScope() {
+    if (nodeScope) return nodeScope;
     nodeScope = new Scope();
     decls->DeclareAll(nodeScope);
-    decls->CheckAll();
+    return nodeScope;
 }
 
-StmtBlock::StmtBlock(List<VarDecl*> *d, List<Stmt*> *s) {
+StmtBlock::StmtBlock(yyltype loc, List<VarDecl*> *d, List<Stmt*> *s) : Stmt(loc) {
+    kind = kStmtBlock;
     Assert(d != NULL && s != NULL);
     (decls=d)->SetParentAll(this);
     (stmts=s)->SetParentAll(this);
 }
 void StmtBlock::Check() {
     // printf("check StmtBlock\n");
-    nodeScope = new Scope();
-    decls->DeclareAll(nodeScope);
+    PrepareScope();
     decls->CheckAll();
     stmts->CheckAll();
     
     // printf("%s:%d\n", __PRETTY_FUNCTION__, __LINE__);
 }
 
+Scope *StmtBlock::PrepareScope() {
+    if (nodeScope) return nodeScope;
+    nodeScope = new Scope(parent->GetEnclosingScope());
+    decls->DeclareAll(nodeScope);
+    return nodeScope;
+}
+
 ConditionalStmt::ConditionalStmt(Expr *t, Stmt *b) { 
     Assert(t != NULL && b != NULL);
     (test=t)->SetParent(this); 
@@ -54,6 +219,7 @@ void ConditionalStmt::Check() {
 }
 
 ForStmt::ForStmt(Expr *i, Expr *t, Expr *s, Stmt *b): LoopStmt(t, b) { 
+    kind = kForStmt;
     Assert(i != NULL && t != NULL && s != NULL && b != NULL);
     (init=i)->SetParent(this);
     (step=s)->SetParent(this);
@@ -61,6 +227,7 @@ ForStmt::ForStmt(Expr *i, Expr *t, Expr *s, Stmt *b): LoopStmt(t, b) {
 
 
 IfStmt::IfStmt(Expr *t, Stmt *tb, Stmt *eb): ConditionalStmt(t, tb) { 
+    kind = kIfStmt;
     Assert(t != NULL && tb != NULL); // else can be NULL
     elseBody = eb;
     if (elseBody) elseBody->SetParent(this);
@@ -76,14 +243,16 @@ void IfStmt::Check() {
 }
 
 void BreakStmt::Check(){
-    if(dynamic_cast<LoopStmt*>(this->GetParent())){
-        return;
-    }
+    // the loop may be further up, with blocks and ifs in between
+    for (Node *n = this->GetParent(); n && !isa<FnDecl>(n); n = n->GetParent())
+        if (isa<LoopStmt>(n))
+            return;
     ReportError::BreakOutsideLoop(this);
 }
 
 
 ReturnStmt::ReturnStmt(yyltype loc, Expr *e) : Stmt(loc) { 
+    kind = kReturnStmt;
     Assert(e != NULL);
     (expr=e)->SetParent(this);
 }
@@ -93,6 +262,7 @@ void ReturnStmt::Check(){
 }
   
 PrintStmt::PrintStmt(List<Expr*> *a) {    
+    kind = kPrintStmt;
     Assert(a != NULL);
     (args=a)->SetParentAll(this);
 }
@@ -102,6 +272,7 @@ void PrintStmt::Check(){
 }
 
 SwitchStmt::SwitchStmt(Expr *test, List<Stmt*> *casestmt, List<Stmt*> *stmtList){
+    kind = kSwitchStmt;
     // test->Print(indentLevel+1, "(test) ");
     // body->Print(indentLevel+1, "(then) ");
     Assert(stmtList != NULL);
@@ -117,6 +288,7 @@ void SwitchStmt::PrintChildren(int indentLevel){
 }
 
 CaseStmt::CaseStmt(IntConstant *num, List<Stmt*> *stmtList){
+    kind = kCaseStmt;
     //Assert(n!= NULL);
     (n=num)->SetParent(this);
     (stmts=stmtList)->SetParentAll(this);
@@ -10,8 +10,10 @@
 #ifndef _H_ast_stmt
 #define _H_ast_stmt
 
+#include <vector>
 #include "list.h"
 #include "ast.h"
+#include "errors.h"
 
 class Decl;
 class VarDecl;
@@ -22,10 +24,30 @@ class Program : public Node
 {
   protected:
      List<Decl*> *decls;
+
+        // The bodies are checked in units, a top-level decl whole or a
+        // class member by member, each unit's errors kept until output
+     struct CheckUnit {
+         Decl *decl;   // NULL for the errors of a decl's PrepareCheck
+         std::vector<ReportError::Message> errors;
+     };
+     std::vector<CheckUnit> *units;
      
   public:
      Program(List<Decl*> *declList);
+     List<Decl*> *GetDecls() { return decls; }
      void Check();
+     void Check(int numThreads);
+
+        // The two passes Check makes (see pipeline.h). The errors of
+        // each unit are kept apart until OutputErrors, which CheckBodies
+        // calls when it is done.
+     void Declare();
+     void CheckBodies(int numThreads);
+     void OutputErrors();
+     void CheckInParallel(int numThreads);
+     Scope *PrepareScope();
+     bool OwnsScope() { return true; }
 };
 
 class Stmt : public Node
@@ -40,18 +62,22 @@ class Stmt : public Node
 
 class StmtBlock : public Stmt 
 {
+  friend class AstCache;
   protected:
     List<VarDecl*> *decls;
     List<Stmt*> *stmts;
     
   public:
-    StmtBlock(List<VarDecl*> *variableDeclarations, List<Stmt*> *statements);
+    StmtBlock(yyltype loc, List<VarDecl*> *variableDeclarations, List<Stmt*> *statements);
     void Check();
+    Scope *PrepareScope();
+    bool OwnsScope() { return true; }
 };
 
   
 class ConditionalStmt : public Stmt
 {
+  friend class AstCache;
   protected:
     Expr *test;
     Stmt *body;
@@ -66,10 +92,13 @@ class LoopStmt : public ConditionalStmt
   public:
     LoopStmt(Expr *testExpr, Stmt *body)
             : ConditionalStmt(testExpr, body) {}
+    static bool classof(Node *n)
+        { return n->GetKind() >= kForStmt && n->GetKind() <= kWhileStmt; }
 };
 
 class ForStmt : public LoopStmt 
 {
+  friend class AstCache;
   protected:
     Expr *init, *step;
   
@@ -80,11 +109,12 @@ class ForStmt : public LoopStmt
 class WhileStmt : public LoopStmt 
 {
   public:
-    WhileStmt(Expr *test, Stmt *body) : LoopStmt(test, body) {}
+    WhileStmt(Expr *test, Stmt *body) : LoopStmt(test, body) { kind = kWhileStmt; }
 };
 
 class IfStmt : public ConditionalStmt 
 {
+  friend class AstCache;
   protected:
     Stmt *elseBody;
   
@@ -96,12 +126,13 @@ class IfStmt : public ConditionalStmt
 class BreakStmt : public Stmt 
 {
   public:
-    BreakStmt(yyltype loc) : Stmt(loc) {}
+    BreakStmt(yyltype loc) : Stmt(loc) { kind = kBreakStmt; }
     void Check();
 };
 
 class ReturnStmt : public Stmt  
 {
+  friend class AstCache;
   protected:
     Expr *expr;
   
@@ -112,6 +143,7 @@ class ReturnStmt : public Stmt
 
 class PrintStmt : public Stmt
 {
+  friend class AstCache;
   protected:
     List<Expr*> *args;
     
@@ -121,6 +153,7 @@ class PrintStmt : public Stmt
 };
 
 class SwitchStmt : public Stmt{
+  friend class AstCache;
 
   protected:
     List<Stmt*> *stmts;
@@ -133,6 +166,7 @@ class SwitchStmt : public Stmt{
 };
 
 class CaseStmt : public Stmt{
+  friend class AstCache;
   protected:
     List<Stmt*> *stmts;
     IntConstant *n;
@@ -5,8 +5,13 @@
 #include "ast_type.h"
 #include "ast_decl.h"
 #include <string.h>
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 
 #include "errors.h"
+#include "trace.h"
  
 /* Class constants
  * ---------------
@@ -25,16 +30,80 @@ Type *Type::stringType = new Type("string");
 Type *Type::errorType  = new Type("error"); 
 
 Type::Type(const char *n) {
+    kind = kType;
     Assert(n);
     typeName = strdup(n);
+    shared = true;
+    canonical = this;
+    arrayOf = NULL;
+}
+
+
+/* Canonical types
+ * ---------------
+ * The canonical types are placed in an arena of their own, like the
+ * symbols, since they outlive the trees. The canonical named types are
+ * found by their symbol, and the canonical array of a type is kept in
+ * that type's canonical instance. The checker can ask for them from
+ * several threads at once, so they are looked up under a lock.
+ */
+static Arena typeArena;
+static std::unordered_map<Symbol*, NamedType*> namedTypes;
+static std::mutex tableLock;
+static std::atomic<int> numTypeNodes(0), numLookups(0), numCanonical(0);
+
+NamedType::NamedType(Symbol *name) : Type() {
+    kind = kNamedType;
+    id = ::new (typeArena.Alloc(sizeof(Identifier))) Identifier(yyltype(), name);
+    id->SetParent(this);
+    cachedDecl = NULL;
+    isError = false;
+    shared = true;
+    canonical = this;
+    numCanonical++;
+}
+
+NamedType *NamedType::Canonical(Symbol *name) {
+    numLookups++;
+    std::lock_guard<std::mutex> hold(tableLock);
+    NamedType *&t = namedTypes[name];
+    if (!t) t = ::new (typeArena.Alloc(sizeof(NamedType))) NamedType(name);
+    return t;
+}
+
+ArrayType::ArrayType(Type *et) : Type() {
+    kind = kArrayType;
+    elemType = et;
+    shared = true;
+    canonical = this;
+    numCanonical++;
+}
+
+ArrayType *ArrayType::Canonical(Type *et) {
+    Type *elem = et->GetCanonical();
+    numLookups++;
+    std::lock_guard<std::mutex> hold(tableLock);
+    if (!elem->arrayOf)
+        elem->arrayOf = ::new (typeArena.Alloc(sizeof(ArrayType))) ArrayType(elem);
+    return (ArrayType *)elem->arrayOf;
+}
+
+void Type::PrintStats() {
+    PrintDebug(kTraceTypes, "%d type nodes and %d checker types share %d canonical types",
+               (int)numTypeNodes, numLookups - numTypeNodes, (int)numCanonical);
 }
 
 
 
 	
 NamedType::NamedType(Identifier *i) : Type(*i->GetLocation()) {
+    kind = kNamedType;
     Assert(i != NULL);
     (id=i)->SetParent(this);
+    cachedDecl = NULL;
+    isError = false;
+    canonical = Canonical(i->GetSymbol());
+    numTypeNodes++;
 } 
 
 void NamedType::Check() {
@@ -62,27 +131,15 @@ bool NamedType::IsClass() {
     return (d && d->IsClassDecl());
 }
 
-bool NamedType::IsEquivalentTo(Type *other) {
-    NamedType *ot = dynamic_cast<NamedType*>(other);
-    return ot && strcmp(id->GetName(), ot->id->GetName()) == 0;
-}
-
 ArrayType::ArrayType(yyltype loc, Type *et) : Type(loc) {
+    kind = kArrayType;
     Assert(et != NULL);
     (elemType=et)->SetParent(this);
-}
-
-ArrayType::ArrayType(Type *et) :Type(){
-    Assert(et != NULL);
-    (elemType=et)->SetParent(this);
+    canonical = Canonical(et);
+    numTypeNodes++;
 }
 
 void ArrayType::Check() {
     elemType->Check();
 }
 
-bool ArrayType::IsEquivalentTo(Type *other) {
-    ArrayType *o = dynamic_cast<ArrayType*>(other);
-    return (o && elemType->IsEquivalentTo(o->elemType));
-}
-
@@ -4,6 +4,16 @@
  * store type information. The base Type class is used
  * for built-in types, the NamedType for classes and interfaces,
  * and the ArrayType for arrays of other types.  
+ *
+ * Canonical types: every distinct type (int, Foo, Foo[][], ...) has one
+ * canonical instance, which each node for that type points to, so two
+ * types are equivalent exactly when they have the same canonical type.
+ * The builtin types are their own. The others are made the first time
+ * they are needed and kept for the rest of the run, shared by all the
+ * trees like the builtin types. Being in no tree, they have no scope to
+ * look up the declaration of a named type in. With -d types, how many
+ * type nodes there were and how many canonical types they came down to
+ * is printed at the end.
  */
  
 #ifndef _H_ast_type
@@ -18,18 +28,30 @@ class Type : public Node
 {
   protected:
     char *typeName;
+    bool shared;       // a builtin or canonical type, in no one tree
+    Type *canonical;
+    Type *arrayOf;     // for a canonical type, the canonical array of it
+    friend class ArrayType;
 
   public :
     static Type *intType, *doubleType, *boolType, *voidType,
                 *nullType, *stringType, *errorType;
 
-    Type() : Node(){}
-    Type(yyltype loc) : Node(loc) {}
+    Type() : Node(), shared(false), canonical(NULL), arrayOf(NULL) {}
+    Type(yyltype loc) : Node(loc), shared(false), canonical(NULL), arrayOf(NULL) {}
     Type(const char *str);
+    static bool classof(Node *n)
+        { return n->GetKind() >= kType && n->GetKind() <= kArrayType; }
+
+          // The shared types are used by all the trees being built,
+          // possibly on other threads, so they are left without a parent
+    void SetParent(Node *p) { if (!shared) Node::SetParent(p); }
+    Type *GetCanonical() { return canonical; }
+    bool IsEquivalentTo(Type *other) { return canonical == other->canonical; }
+    static void PrintStats();
     
     virtual void PrintToStream(std::ostream& out) { out << typeName; }
     friend std::ostream& operator<<(std::ostream& out, Type *t) { t->PrintToStream(out); return out; }
-    virtual bool IsEquivalentTo(Type *other) { return this == other; }
     virtual const char* GetName(){ return typeName; }    
     virtual bool IsPrimitiveType(){ return true; }
 };
@@ -40,9 +62,13 @@ class NamedType : public Type
     Identifier *id;
     Decl *cachedDecl; // either class or inteface
     bool isError;
+
+    NamedType(Symbol *name);  // the canonical instance
     
   public:
     NamedType(Identifier *i);
+    static NamedType *Canonical(Symbol *name);
+    static bool classof(Node *n) { return n->GetKind() == kNamedType; }
     
     void PrintToStream(std::ostream& out) { out << id; }
     void Check();
@@ -50,7 +76,6 @@ class NamedType : public Type
     bool IsInterface();
     bool IsClass();
     Identifier *GetId() { return id; }
-    bool IsEquivalentTo(Type *other);    
     const char* GetName(){ return id->GetName(); }
     bool IsPrimitiveType(){ return false; }
 };
@@ -60,13 +85,15 @@ class ArrayType : public Type
   protected:
     Type *elemType;
 
+    ArrayType(Type* elemType);  // the canonical instance
+
   public:
     ArrayType(yyltype loc, Type *elemType);
-    ArrayType(Type* elemType);
+    static ArrayType *Canonical(Type *elemType);
+    static bool classof(Node *n) { return n->GetKind() == kArrayType; }
     
     void PrintToStream(std::ostream& out) { out << elemType << "[]"; }
     void Check();
-    bool IsEquivalentTo(Type *other);
     Type* GetElemType(){ return elemType; }
     const char* GetName(){ return elemType->GetName(); }
     bool IsPrimitiveType(){ return false; }
@@ -0,0 +1,854 @@
+/* File: astcache.cc
+ * -----------------
+ * Implementation of the tree cache.
+ *
+ * A cache file starts with a Header: a magic string that names the
+ * version of the format, the size and hash of the source, and a hash of
+ * the rest of the file, which is checked before anything in it is used.
+ * The rest is a sequence of numbers, each written in as many bytes as it
+ * takes, seven bits to a byte and the top bit set on all but the last:
+ *
+ *    the names: how many, then each one's length and characters
+ *    the errors: how many, then each one's line, refLine, refAt, text
+ *    the tree, in preorder
+ *
+ * A node is written as its Kind followed by what the constructor for its
+ * class takes, in order. A location is its first line and column and its
+ * last line and column, the lines as differences (from the first line of
+ * the location before, and from the first line) so that they mostly take
+ * a byte. An identifier is a location and the number of its name, a list
+ * is its length and then its elements, and a missing node is kind kNone.
+ * The nodes whose constructors work out their location from their
+ * children are given just the children, and work it out again the same
+ * way. Builtin types are written by number.
+ */
+
+#include "astcache.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "ast_decl.h"
+#include "ast_expr.h"
+#include "ast_stmt.h"
+#include "ast_type.h"
+#include "errors.h"
+#include "parser.h"
+#include "source.h"
+#include "utility.h"
+#include "trace.h"
+using namespace std;
+
+typedef vector<ReportError::Message> Messages;
+
+struct Header {
+    char magic[8];
+    uint64_t size, hash;   // of the source
+    uint64_t check;        // hash of the rest of the file
+};
+static const char Magic[8] = {'D', 'C', 'C', 'T', 'R', 'E', 'E', '1'};
+
+enum Kind {
+    kNone, kBuiltinType, kProgram,
+    kVarDecl, kFnDecl, kClassDecl, kInterfaceDecl,
+    kStmtBlock, kForStmt, kWhileStmt, kIfStmt, kBreakStmt, kReturnStmt,
+    kPrintStmt, kSwitchStmt, kCaseStmt,
+    kEmptyExpr, kIntConstant, kDoubleConstant, kBoolConstant,
+    kStringConstant, kNullConstant,
+    kArithmeticExpr, kRelationalExpr, kEqualityExpr, kLogicalExpr, kAssignExpr,
+    kThis, kArrayAccess, kFieldAccess, kPostfix, kCall, kNewExpr,
+    kNewArrayExpr, kReadIntegerExpr, kReadLineExpr,
+    kNamedType, kArrayType,
+    NumKinds
+};
+
+// What each kind of node can stand in for, so the reader can tell a
+// node that does not belong where it is found without a dynamic_cast.
+enum { IsProgram = 1, IsDecl = 2, IsVarDecl = 4, IsStmt = 8, IsBlock = 16,
+       IsExpr = 32, IsIntConstant = 64, IsType = 128, IsNamedType = 256 };
+
+static const int kindClasses[NumKinds] = {
+    0, IsType, IsProgram,
+    IsDecl | IsVarDecl, IsDecl, IsDecl, IsDecl,
+    IsStmt | IsBlock, IsStmt, IsStmt, IsStmt, IsStmt, IsStmt,
+    IsStmt, IsStmt, IsStmt,
+    IsStmt | IsExpr, IsStmt | IsExpr | IsIntConstant, IsStmt | IsExpr, IsStmt | IsExpr,
+    IsStmt | IsExpr, IsStmt | IsExpr,
+    IsStmt | IsExpr, IsStmt | IsExpr, IsStmt | IsExpr, IsStmt | IsExpr, IsStmt | IsExpr,
+    IsStmt | IsExpr, IsStmt | IsExpr, IsStmt | IsExpr, IsStmt | IsExpr, IsStmt | IsExpr, IsStmt | IsExpr,
+    IsStmt | IsExpr, IsStmt | IsExpr, IsStmt | IsExpr,
+    IsType | IsNamedType, IsType
+};
+
+static Type **const builtins[] = {
+    &Type::intType, &Type::doubleType, &Type::boolType, &Type::voidType,
+    &Type::nullType, &Type::stringType, &Type::errorType
+};
+static const int NumBuiltins = sizeof(builtins) / sizeof(builtins[0]);
+
+
+/* Function: Hash
+ * --------------
+ * A 64-bit hash of the bytes, taking them eight at a time: each word is
+ * mixed in with a multiply and a shift, the bytes left over at the end
+ * one by one as in FNV-1a.
+ */
+static uint64_t Hash(const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t h = 14695981039346656037ULL ^ size;
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ word) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    for (; size > 0; p++, size--)
+        h = (h ^ *p) * 1099511628211ULL;
+    return h ^ (h >> 32);
+}
+
+
+/* The writer puts the tree in out while noting down the names it uses,
+ * then writes the file with the names and errors ahead of the tree. It
+ * gives up on a node of a class the parser does not build.
+ */
+class AstCache::Writer
+{
+  public:
+    string out;
+    vector<Symbol*> names;
+    vector<int> nameNumbers;   // by symbol id, -1 if not numbered yet
+    int line;                  // the first line of the last location
+    bool complete;
+
+    Writer() : nameNumbers(Symbol::NumSymbols(), -1), line(0), complete(true) {}
+    void Save(const char *path, size_t size, uint64_t hash,
+              Program *program, const Messages &errors);
+
+  private:
+    void Number(uint64_t n);
+    void Signed(int n)  { Number(n < 0 ? ~((uint64_t)n << 1) : (uint64_t)n << 1); }
+    void Text(const char *s, size_t length);
+    void Location(Node *n);
+    void Name(Identifier *id);
+    void Op(Operator *op);
+    template <class T> void Nodes(List<T*> *list)
+        { Number(list->NumElements());
+          for (int i = 0; i < list->NumElements(); i++)
+              Tree(list->Nth(i)); }
+    void Tree(Node *n);
+};
+
+void AstCache::Writer::Number(uint64_t n)
+{
+    while (n >= 0x80) {
+        out += (char)(n | 0x80);
+        n >>= 7;
+    }
+    out += (char)n;
+}
+
+void AstCache::Writer::Text(const char *s, size_t length)
+{
+    Number(length);
+    out.append(s, length);
+}
+
+void AstCache::Writer::Location(Node *n)
+{
+    yyltype *loc = n->GetLocation();
+    Assert(loc != NULL);
+    Signed(loc->first_line - line);
+    Number((uint32_t)loc->first_column);
+    Signed(loc->last_line - loc->first_line);
+    Number((uint32_t)loc->last_column);
+    line = loc->first_line;
+}
+
+void AstCache::Writer::Name(Identifier *id)
+{
+    Location(id);
+    Symbol *s = id->GetSymbol();
+    if ((int)nameNumbers.size() <= s->GetId())
+        nameNumbers.resize(s->GetId() + 1, -1);
+    int &number = nameNumbers[s->GetId()];
+    if (number < 0) {
+        number = names.size();
+        names.push_back(s);
+    }
+    Number(number);
+}
+
+// The token is written with its terminating null, and string constants
+// below too, so they can be handed to the constructors straight from the
+// mapped file.
+void AstCache::Writer::Op(Operator *op)
+{
+    Location(op);
+    Text(op->str(), strlen(op->str()) + 1);
+}
+
+void AstCache::Writer::Tree(Node *n)
+{
+    if (!n) {
+        Number(kNone);
+        return;
+    }
+
+    switch (n->GetKind()) {
+      case Node::kType:
+        for (int i = 0; i < NumBuiltins; i++)
+            if (n == *builtins[i]) {
+                Number(kBuiltinType);
+                Number(i);
+                return;
+            }
+        complete = false;
+        break;
+      case Node::kProgram:
+        Number(kProgram);
+        Nodes(((Program *)n)->GetDecls());
+        break;
+      case Node::kVarDecl: {
+        VarDecl *d = (VarDecl *)n;
+        Number(kVarDecl);
+        Name(d->GetId());
+        Tree(d->GetDeclaredType());
+        break;
+      }
+      case Node::kFnDecl: {
+        FnDecl *d = (FnDecl *)n;
+        Number(kFnDecl);
+        Name(d->GetId());
+        Tree(d->returnType);
+        Nodes(d->formals);
+        Tree(d->GetBody());
+        break;
+      }
+      case Node::kClassDecl: {
+        ClassDecl *d = (ClassDecl *)n;
+        Number(kClassDecl);
+        Name(d->GetId());
+        Tree(d->extends);
+        Nodes(d->implements);
+        Nodes(d->members);
+        break;
+      }
+      case Node::kInterfaceDecl: {
+        InterfaceDecl *d = (InterfaceDecl *)n;
+        Number(kInterfaceDecl);
+        Name(d->GetId());
+        Nodes(d->members);
+        break;
+      }
+      case Node::kStmtBlock: {
+        StmtBlock *s = (StmtBlock *)n;
+        Number(kStmtBlock);
+        Location(s);
+        Nodes(s->decls);
+        Nodes(s->stmts);
+        break;
+      }
+      case Node::kForStmt: {
+        ForStmt *s = (ForStmt *)n;
+        Number(kForStmt);
+        Tree(s->init);
+        Tree(s->test);
+        Tree(s->step);
+        Tree(s->body);
+        break;
+      }
+      case Node::kWhileStmt: {
+        WhileStmt *s = (WhileStmt *)n;
+        Number(kWhileStmt);
+        Tree(s->test);
+        Tree(s->body);
+        break;
+      }
+      case Node::kIfStmt: {
+        IfStmt *s = (IfStmt *)n;
+        Number(kIfStmt);
+        Tree(s->test);
+        Tree(s->body);
+        Tree(s->elseBody);
+        break;
+      }
+      case Node::kBreakStmt:
+        Number(kBreakStmt);
+        Location(n);
+        break;
+      case Node::kReturnStmt:
+        Number(kReturnStmt);
+        Location(n);
+        Tree(((ReturnStmt *)n)->expr);
+        break;
+      case Node::kPrintStmt:
+        Number(kPrintStmt);
+        Nodes(((PrintStmt *)n)->args);
+        break;
+      case Node::kSwitchStmt:
+        Number(kSwitchStmt);
+        Nodes(((SwitchStmt *)n)->stmts);
+        break;
+      case Node::kCaseStmt: {
+        CaseStmt *s = (CaseStmt *)n;
+        Number(kCaseStmt);
+        Tree(s->n);
+        Nodes(s->stmts);
+        break;
+      }
+      case Node::kEmptyExpr:
+        Number(kEmptyExpr);
+        break;
+      case Node::kIntConstant:
+        Number(kIntConstant);
+        Location(n);
+        Number((uint32_t)((IntConstant *)n)->value);
+        break;
+      case Node::kDoubleConstant:
+        Number(kDoubleConstant);
+        Location(n);
+        out.append((const char *)&((DoubleConstant *)n)->value, sizeof(double));
+        break;
+      case Node::kBoolConstant:
+        Number(kBoolConstant);
+        Location(n);
+        Number(((BoolConstant *)n)->value);
+        break;
+      case Node::kStringConstant: {
+        const char *value = ((StringConstant *)n)->value;
+        Number(kStringConstant);
+        Location(n);
+        Text(value, strlen(value) + 1);
+        break;
+      }
+      case Node::kNullConstant:
+        Number(kNullConstant);
+        Location(n);
+        break;
+      case Node::kArithmeticExpr:
+      case Node::kRelationalExpr:
+      case Node::kEqualityExpr:
+      case Node::kLogicalExpr:
+      case Node::kAssignExpr: {
+        CompoundExpr *e = (CompoundExpr *)n;
+        Node::Kind k = n->GetKind();
+        Number(k == Node::kArithmeticExpr ? kArithmeticExpr :
+               k == Node::kRelationalExpr ? kRelationalExpr :
+               k == Node::kEqualityExpr ? kEqualityExpr :
+               k == Node::kLogicalExpr ? kLogicalExpr : kAssignExpr);
+        Tree(e->left);
+        Op(e->op);
+        Tree(e->right);
+        break;
+      }
+      case Node::kThis:
+        Number(kThis);
+        Location(n);
+        break;
+      case Node::kArrayAccess: {
+        ArrayAccess *e = (ArrayAccess *)n;
+        Number(kArrayAccess);
+        Location(e);
+        Tree(e->base);
+        Tree(e->subscript);
+        break;
+      }
+      case Node::kFieldAccess: {
+        FieldAccess *e = (FieldAccess *)n;
+        Number(kFieldAccess);
+        Tree(e->base);
+        Name(e->field);
+        break;
+      }
+      case Node::kPostfix: {
+        Postfix *e = (Postfix *)n;
+        Number(kPostfix);
+        Op(e->op);
+        Tree(e->right);
+        break;
+      }
+      case Node::kCall: {
+        Call *e = (Call *)n;
+        Number(kCall);
+        Location(e);
+        Tree(e->base);
+        Name(e->field);
+        Nodes(e->actuals);
+        break;
+      }
+      case Node::kNewExpr:
+        Number(kNewExpr);
+        Location(n);
+        Tree(((NewExpr *)n)->cType);
+        break;
+      case Node::kNewArrayExpr: {
+        NewArrayExpr *e = (NewArrayExpr *)n;
+        Number(kNewArrayExpr);
+        Location(e);
+        Tree(e->size);
+        Tree(e->elemType);
+        break;
+      }
+      case Node::kReadIntegerExpr:
+        Number(kReadIntegerExpr);
+        Location(n);
+        break;
+      case Node::kReadLineExpr:
+        Number(kReadLineExpr);
+        Location(n);
+        break;
+      case Node::kNamedType:
+        Number(kNamedType);
+        Name(((NamedType *)n)->GetId());
+        break;
+      case Node::kArrayType:
+        Number(kArrayType);
+        Location(n);
+        Tree(((ArrayType *)n)->GetElemType());
+        break;
+      default:
+        complete = false;
+        break;
+    }
+}
+
+/* Method: Save
+ * ------------
+ * The file is written under a temporary name and then renamed, so that
+ * another dcc reading it at the same time finds either the old file or
+ * the new one, never a part of one.
+ */
+void AstCache::Writer::Save(const char *path, size_t size, uint64_t hash,
+                            Program *program, const Messages &errors)
+{
+    Tree(program);
+    if (!complete) {
+        PrintDebug(kTraceAstCache, "Tree not saved, it has a node the cache does not know");
+        return;
+    }
+    string tree;
+    tree.swap(out);
+    Number(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+        Text(names[i]->GetName(), names[i]->GetLength());
+    Number(errors.size());
+    for (size_t i = 0; i < errors.size(); i++) {
+        Number((uint32_t)errors[i].line);
+        Number((uint32_t)errors[i].refLine);
+        Number(errors[i].refAt);
+        Text(errors[i].text.data(), errors[i].text.size());
+    }
+
+    out += tree;
+    Header h;
+    memcpy(h.magic, Magic, sizeof(Magic));
+    h.size = size;
+    h.hash = hash;
+    h.check = Hash(out.data(), out.size());
+    char temp[4096];
+    snprintf(temp, sizeof(temp), "%s.%d.tmp", path, (int)getpid());
+    FILE *fp = fopen(temp, "wb");
+    if (!fp) {
+        PrintDebug(kTraceAstCache, "Cannot write %s", temp);
+        return;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+              fwrite(out.data(), 1, out.size(), fp) == out.size();
+    if (fclose(fp) != 0 || !ok || rename(temp, path) != 0) {
+        PrintDebug(kTraceAstCache, "Cannot write %s", path);
+        remove(temp);
+        return;
+    }
+    PrintDebug(kTraceAstCache, "Saved the tree in %s", path);
+}
+
+
+/* The reader takes the numbers out of the mapped file from next up to
+ * end. Everything in the file is checked as it is read, a file that is
+ * damaged or cut short makes ok false (and the constructors are not
+ * called with what was read from it), the partial tree is then dropped.
+ */
+class AstCache::Reader
+{
+  public:
+    Program *program;
+    Messages errors;
+
+    Reader() : program(NULL), ok(false), line(0) {}
+    bool Load(const char *path, size_t size, uint64_t hash);
+
+  private:
+    const unsigned char *next, *end;
+    bool ok;
+    vector<Symbol*> names;
+    int line;
+
+    uint64_t Number();
+    int Int() { return (int)(uint32_t)Number(); }
+    int Signed() { uint64_t n = Number(); return (int)(n & 1 ? ~(n >> 1) : n >> 1); }
+    const char *Text(size_t *length);
+    const char *String();
+    yyltype Location();
+    Identifier *Name();
+    Operator *Op();
+    Node *Tree(int accepted);
+    template <class T> T *Get(int accepted)
+        { return static_cast<T*>(Tree(accepted)); }
+    template <class T> T *Need(int accepted)
+        { T *t = Get<T>(accepted);
+          if (!t) ok = false;
+          return t; }
+    template <class T> List<T*> *Nodes(int accepted)
+        { List<T*> *list = new List<T*>;
+          uint64_t n = Number();
+          for (uint64_t i = 0; i < n && ok; i++) {
+              T *t = Need<T>(accepted);
+              if (ok) list->Append(t);
+          }
+          return list; }
+};
+
+uint64_t AstCache::Reader::Number()
+{
+    uint64_t n = 0;
+    for (int shift = 0; next < end && shift < 64; shift += 7) {
+        unsigned char b = *next++;
+        n |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return n;
+    }
+    ok = false;
+    return 0;
+}
+
+const char *AstCache::Reader::Text(size_t *length)
+{
+    uint64_t n = Number();
+    if (n > (uint64_t)(end - next)) {
+        ok = false;
+        n = 0;
+    }
+    const char *s = (const char *)next;
+    next += n;
+    *length = n;
+    return s;
+}
+
+// Text written with its null, as a C string
+const char *AstCache::Reader::String()
+{
+    size_t length;
+    const char *s = Text(&length);
+    if (length == 0 || s[length - 1] != '\0') {
+        ok = false;
+        return "";
+    }
+    return s;
+}
+
+yyltype AstCache::Reader::Location()
+{
+    yyltype loc = yyltype();
+    loc.first_line = line += Signed();
+    loc.first_column = Int();
+    loc.last_line = loc.first_line + Signed();
+    loc.last_column = Int();
+    return loc;
+}
+
+Identifier *AstCache::Reader::Name()
+{
+    yyltype loc = Location();
+    uint64_t number = Number();
+    if (number >= names.size()) {
+        ok = false;
+        return NULL;
+    }
+    return new Identifier(loc, names[number]);
+}
+
+Operator *AstCache::Reader::Op()
+{
+    yyltype loc = Location();
+    const char *token = String();
+    return new Operator(loc, token);
+}
+
+/* Method: Tree
+ * ------------
+ * Reads a node that has to be of one of the accepted kinds (or missing).
+ * The parts of a node are read into locals first, one statement each, as
+ * the order the arguments of a call are evaluated in is not fixed.
+ */
+Node *AstCache::Reader::Tree(int accepted)
+{
+    uint64_t kind = Number();
+    if (kind == kNone)
+        return NULL;
+    if (kind >= NumKinds || !(kindClasses[kind] & accepted)) {
+        ok = false;
+        return NULL;
+    }
+
+    switch (kind) {
+      case kBuiltinType: {
+        uint64_t i = Number();
+        if (i < NumBuiltins) return *builtins[i];
+        break;
+      }
+      case kProgram: {
+        List<Decl*> *decls = Nodes<Decl>(IsDecl);
+        return ok ? new Program(decls) : NULL;
+      }
+      case kVarDecl: {
+        Identifier *id = Name();
+        Type *type = Need<Type>(IsType);
+        return ok ? new VarDecl(id, type) : NULL;
+      }
+      case kFnDecl: {
+        Identifier *id = Name();
+        Type *returnType = Need<Type>(IsType);
+        List<VarDecl*> *formals = Nodes<VarDecl>(IsVarDecl);
+        if (!ok) break;
+        FnDecl *fn = new FnDecl(id, returnType, formals);
+        Stmt *body = Get<Stmt>(IsBlock);
+        if (body) fn->SetFunctionBody(body);
+        return fn;
+      }
+      case kClassDecl: {
+        Identifier *id = Name();
+        NamedType *extends = Get<NamedType>(IsNamedType);
+        List<NamedType*> *implements = Nodes<NamedType>(IsNamedType);
+        List<Decl*> *members = Nodes<Decl>(IsDecl);
+        return ok ? new ClassDecl(id, extends, implements, members) : NULL;
+      }
+      case kInterfaceDecl: {
+        Identifier *id = Name();
+        List<Decl*> *members = Nodes<Decl>(IsDecl);
+        return ok ? new InterfaceDecl(id, members) : NULL;
+      }
+
+      case kStmtBlock: {
+        yyltype loc = Location();
+        List<VarDecl*> *decls = Nodes<VarDecl>(IsVarDecl);
+        List<Stmt*> *stmts = Nodes<Stmt>(IsStmt);
+        return ok ? new StmtBlock(loc, decls, stmts) : NULL;
+      }
+      case kForStmt: {
+        Expr *init = Need<Expr>(IsExpr);
+        Expr *test = Need<Expr>(IsExpr);
+        Expr *step = Need<Expr>(IsExpr);
+        Stmt *body = Need<Stmt>(IsStmt);
+        return ok ? new ForStmt(init, test, step, body) : NULL;
+      }
+      case kWhileStmt: {
+        Expr *test = Need<Expr>(IsExpr);
+        Stmt *body = Need<Stmt>(IsStmt);
+        return ok ? new WhileStmt(test, body) : NULL;
+      }
+      case kIfStmt: {
+        Expr *test = Need<Expr>(IsExpr);
+        Stmt *thenBody = Need<Stmt>(IsStmt);
+        Stmt *elseBody = Get<Stmt>(IsStmt);
+        return ok ? new IfStmt(test, thenBody, elseBody) : NULL;
+      }
+      case kBreakStmt:
+        return new BreakStmt(Location());
+      case kReturnStmt: {
+        yyltype loc = Location();
+        Expr *expr = Need<Expr>(IsExpr);
+        return ok ? new ReturnStmt(loc, expr) : NULL;
+      }
+      case kPrintStmt: {
+        List<Expr*> *args = Nodes<Expr>(IsExpr);
+        return ok ? new PrintStmt(args) : NULL;
+      }
+      case kSwitchStmt: {
+        List<Stmt*> *stmts = Nodes<Stmt>(IsStmt);
+        return ok ? new SwitchStmt(NULL, NULL, stmts) : NULL;
+      }
+      case kCaseStmt: {
+        IntConstant *n = Need<IntConstant>(IsIntConstant);
+        List<Stmt*> *stmts = Nodes<Stmt>(IsStmt);
+        return ok ? new CaseStmt(n, stmts) : NULL;
+      }
+
+      case kEmptyExpr:
+        return new EmptyExpr();
+      case kIntConstant: {
+        yyltype loc = Location();
+        return new IntConstant(loc, Int());
+      }
+      case kDoubleConstant: {
+        yyltype loc = Location();
+        double value;
+        if (end - next < (ptrdiff_t)sizeof(value)) break;
+        memcpy(&value, next, sizeof(value));
+        next += sizeof(value);
+        return new DoubleConstant(loc, value);
+      }
+      case kBoolConstant: {
+        yyltype loc = Location();
+        return new BoolConstant(loc, Number() != 0);
+      }
+      case kStringConstant: {
+        yyltype loc = Location();
+        return new StringConstant(loc, String());
+      }
+      case kNullConstant:
+        return new NullConstant(Location());
+      case kArithmeticExpr:
+      case kLogicalExpr: {
+        Expr *left = Get<Expr>(IsExpr);   // NULL if unary
+        Operator *op = Op();
+        Expr *right = Need<Expr>(IsExpr);
+        if (!ok) break;
+        if (kind == kArithmeticExpr)
+            return left ? new ArithmeticExpr(left, op, right) : new ArithmeticExpr(op, right);
+        return left ? new LogicalExpr(left, op, right) : new LogicalExpr(op, right);
+      }
+      case kRelationalExpr:
+      case kEqualityExpr:
+      case kAssignExpr: {
+        Expr *left = Need<Expr>(IsExpr);
+        Operator *op = Op();
+        Expr *right = Need<Expr>(IsExpr);
+        if (!ok) break;
+        if (kind == kRelationalExpr) return new RelationalExpr(left, op, right);
+        if (kind == kEqualityExpr) return new EqualityExpr(left, op, right);
+        return new AssignExpr(left, op, right);
+      }
+      case kThis:
+        return new This(Location());
+      case kArrayAccess: {
+        yyltype loc = Location();
+        Expr *base = Need<Expr>(IsExpr);
+        Expr *subscript = Need<Expr>(IsExpr);
+        return ok ? new ArrayAccess(loc, base, subscript) : NULL;
+      }
+      case kFieldAccess: {
+        Expr *base = Get<Expr>(IsExpr);
+        Identifier *field = Name();
+        return ok ? new FieldAccess(base, field) : NULL;
+      }
+      case kPostfix: {
+        Operator *op = Op();
+        Expr *right = Need<Expr>(IsExpr);
+        return ok ? new Postfix(op, right) : NULL;
+      }
+      case kCall: {
+        yyltype loc = Location();
+        Expr *base = Get<Expr>(IsExpr);
+        Identifier *field = Name();
+        List<Expr*> *actuals = Nodes<Expr>(IsExpr);
+        return ok ? new Call(loc, base, field, actuals) : NULL;
+      }
+      case kNewExpr: {
+        yyltype loc = Location();
+        NamedType *cType = Need<NamedType>(IsNamedType);
+        return ok ? new NewExpr(loc, cType) : NULL;
+      }
+      case kNewArrayExpr: {
+        yyltype loc = Location();
+        Expr *size = Need<Expr>(IsExpr);
+        Type *elemType = Need<Type>(IsType);
+        return ok ? new NewArrayExpr(loc, size, elemType) : NULL;
+      }
+      case kReadIntegerExpr:
+        return new ReadIntegerExpr(Location());
+      case kReadLineExpr:
+        return new ReadLineExpr(Location());
+
+      case kNamedType: {
+        Identifier *id = Name();
+        return ok ? new NamedType(id) : NULL;
+      }
+      case kArrayType: {
+        yyltype loc = Location();
+        Type *elemType = Need<Type>(IsType);
+        return ok ? new ArrayType(loc, elemType) : NULL;
+      }
+    }
+    ok = false;
+    return NULL;
+}
+
+/* Method: Load
+ * ------------
+ * Reads the cache file at path, returning whether it was there and was
+ * written for this source. The names are interned and the strings copied
+ * into the tree as they are read, so the file is unmapped again after.
+ */
+bool AstCache::Reader::Load(const char *path, size_t size, uint64_t hash)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Header))
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    Header h;
+    memcpy(&h, map, sizeof(h));
+    next = (const unsigned char *)map + sizeof(h);
+    end = (const unsigned char *)map + st.st_size;
+    ok = memcmp(h.magic, Magic, sizeof(Magic)) == 0 && h.size == size && h.hash == hash &&
+         h.check == Hash(next, end - next);
+    if (ok) {
+        uint64_t numNames = Number();
+        for (uint64_t i = 0; i < numNames && ok; i++) {
+            size_t length;
+            const char *name = Text(&length);
+            names.push_back(Symbol::Intern(name, length));
+        }
+        uint64_t numErrors = Number();
+        for (uint64_t i = 0; i < numErrors && ok; i++) {
+            ReportError::Message m;
+            m.line = Int();
+            m.refLine = Int();
+            m.refAt = Number();
+            size_t length;
+            const char *text = Text(&length);
+            m.text.assign(text, length);
+            errors.push_back(m);
+        }
+        program = Get<Program>(IsProgram);
+        ok = ok && next == end;
+    }
+    munmap(map, st.st_size);
+    return ok;
+}
+
+
+Program *AstCache::Parse(const char *path, Scanner *scanner)
+{
+    size_t size;
+    const char *text = GetSourceText(&size);
+    uint64_t hash = Hash(text, size);
+
+    Reader reader;
+    if (reader.Load(path, size, hash)) {
+        PrintDebug(kTraceAstCache, "Using the tree saved in %s", path);
+        SetSource(text, size);   // index all the lines for the checker's errors
+        ReportError::OutputSaved(reader.errors);
+        return reader.program;
+    }
+
+    Messages errors;
+    ReportError::CaptureOutput(&errors);
+    Program *program = ParseProgram(scanner);
+    ReportError::CaptureOutput(NULL);
+    ReportError::OutputCaptured(errors);
+    Writer writer;
+    writer.Save(path, size, hash, program, errors);
+    return program;
+}
@@ -0,0 +1,39 @@
+/* File: astcache.h
+ * ----------------
+ * The tree cache lets dcc skip parsing a program it has parsed before.
+ * With --ast-cache <file>, the tree the parser builds is written to file
+ * in a compact binary form, along with the errors the scanner reported
+ * while reading the program and a hash of its source. The next time dcc
+ * is run on the same source with the same cache file, the file is mapped
+ * and the tree put back together from it without running the parser at
+ * all, and the saved errors are reported again. The usual place for the
+ * file is next to the source, as foo.decaf.ast.
+ *
+ * A cache file for other source (or in another version of the format) is
+ * not used, the source is parsed and the file written over. The tree
+ * read back is the one the parser builds, the same nodes with the same
+ * locations, except that it has nothing of what the parser drops from
+ * the tree either (the test and the cases of a switch).
+ */
+
+#ifndef _H_astcache
+#define _H_astcache
+
+class Program;
+class Scanner;
+
+class AstCache
+{
+  public:
+        // Returns the program the source parses to, NULL if it has a
+        // syntax error, like ParseProgram. It comes from the cache file
+        // at path if that has it, else the source is parsed with scanner
+        // and the result saved there.
+    static Program *Parse(const char *path, Scanner *scanner);
+
+  private:
+    class Writer;
+    class Reader;
+};
+
+#endif
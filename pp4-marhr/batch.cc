@@ -0,0 +1,137 @@
+/* File: batch.cc
+ * --------------
+ * Implementation of batch mode.
+ *
+ * Each thread has its own Scanner, source and tree arena, and the parser
+ * keeps no state outside the tree it builds, so the threads compile
+ * their files independently. They share the symbol table, which is
+ * locked while there is more than one.
+ */
+
+#include "batch.h"
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "errors.h"
+#include "parser.h"
+#include "scanner.h"
+#include "source.h"
+#include "arena.h"
+#include "utility.h"
+#include "trace.h"
+#include "pipeline.h"
+using namespace std;
+
+struct Result {
+    bool done;
+    int status;
+    string errors;
+};
+
+static vector<string> files;
+static vector<Result> results;
+static atomic<size_t> nextToCompile(0);
+static size_t nextToPrint = 0;
+static mutex printLock;
+
+
+/* Function: Compile
+ * -----------------
+ * Compiles one file in the calling thread's source and arena, and returns
+ * the exit status dcc would have for it. The errors are kept rather than
+ * counted in ReportError::NumErrors, which batch mode does not use.
+ */
+static int Compile(const string &path, string *errors)
+{
+    FILE *fp = fopen(path.c_str(), "r");
+    if (!fp) {
+        *errors = "Can't open " + path + "\n";
+        return 1;
+    }
+    {
+        PassTimer timer(kReadPass);
+        ReadSource(fp);
+    }
+    fclose(fp);
+
+    vector<ReportError::Message> found;
+    ReportError::CaptureOutput(&found);
+    Scanner scanner;
+    RunPasses(&scanner, 1, NULL);
+    ReportError::CaptureOutput(NULL);
+
+    *errors = ReportError::FormatOutput(found);
+    TreeArena().Release();
+    return found.empty() ? 0 : (unsigned char)-1;
+}
+
+
+/* Function: PrintReady
+ * --------------------
+ * Prints the results that are done and have nothing before them still to
+ * be printed, so the output comes in the order of the files.
+ */
+static void PrintReady()
+{
+    lock_guard<mutex> hold(printLock);
+    for (; nextToPrint < results.size() && results[nextToPrint].done; nextToPrint++) {
+        Result &r = results[nextToPrint];
+        printf("file %d %lu %s\n", r.status, (unsigned long)r.errors.size(),
+               files[nextToPrint].c_str());
+        fwrite(r.errors.data(), 1, r.errors.size(), stdout);
+        string().swap(r.errors);
+    }
+    fflush(stdout);
+}
+
+static void Work()
+{
+    UseOwnTreeArena();
+    UseOwnSource();
+    for (size_t i; (i = nextToCompile++) < files.size(); ) {
+        string errors;
+        int status = Compile(files[i], &errors);
+        {
+            lock_guard<mutex> hold(printLock);
+            results[i].status = status;
+            results[i].errors.swap(errors);
+            results[i].done = true;
+        }
+        PrintReady();
+    }
+}
+
+
+int RunBatch()
+{
+    InitParser();
+    const vector<const char*> &named = BatchFiles();
+    files.assign(named.begin(), named.end());
+    if (files.empty()) {
+        char line[4096];
+        while (fgets(line, sizeof(line), stdin)) {
+            line[strcspn(line, "\n")] = '\0';
+            if (line[0]) files.push_back(line);
+        }
+    }
+    results.assign(files.size(), Result());
+
+    int numThreads = NumJobs() < (int)files.size() ? NumJobs() : files.size();
+    Symbol::SetLocking(numThreads > 1);
+    vector<thread> workers;
+    for (int i = 1; i < numThreads; i++)
+        workers.push_back(thread(Work));
+    Work();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    PrintPassTimes();
+    WriteTrace();
+
+    for (size_t i = 0; i < results.size(); i++)
+        if (results[i].status != 0) return -1;
+    return 0;
+}
@@ -0,0 +1,31 @@
+/* File: batch.h
+ * -------------
+ * Batch mode (dcc --batch) compiles many programs in one run, saving the
+ * start-up of a process per file. The files are those named after --batch
+ * up to the next option, or if there are none, the lines read from stdin,
+ * one path to a line. With -j N, N files are compiled at a time, each by
+ * a thread of its own (each file is then checked by that thread alone).
+ *
+ * For each file, in the order given, the output is a line
+ *
+ *    file <status> <n> <path>
+ *
+ * followed by n bytes of error output, exactly what dcc prints for that
+ * file on its own. Status is the exit status dcc would have had, 1 if the
+ * file could not be opened. Each file is read into a source buffer and
+ * parsed into a tree arena of the thread's own, and both are released
+ * before the thread moves on to its next file. The builtin types are the
+ * only part of the tree the files share.
+ */
+
+#ifndef _H_batch
+#define _H_batch
+
+/* Function: RunBatch
+ * ------------------
+ * Compiles the files and prints the results, then returns the exit status:
+ * 0 if every file compiled without error, -1 if not.
+ */
+int RunBatch();
+
+#endif
@@ -0,0 +1,32 @@
+#!/usr/bin/env python3
+# File: genchain.py
+# -----------------
+# Writes a Decaf program with one long chain of classes, each extending
+# the one before it and implementing an interface, to time how class
+# scopes deal with deep inheritance (see Scope::Inherit). Every class
+# declares the given number of fields and as many methods, and refers to
+# members of the classes at the top and the middle of the chain.
+#
+#     bench/genchain.py 200 20 > chain200.decaf
+#     bench/genchain.py 200 200 > chain200b.decaf
+#     bench/timedcc.py 3 chain200.decaf ./dcc
+#
+# The arguments are the depth of the chain (200 if not given) and the
+# number of fields and methods of each class (20 if not given).
+
+import sys
+
+depth = int(sys.argv[1]) if len(sys.argv) > 1 else 200
+members = int(sys.argv[2]) if len(sys.argv) > 2 else 20
+
+print("interface Shape { int area(); }")
+for i in range(depth):
+    extends = " extends C%d" % (i - 1) if i else ""
+    print("class C%d%s implements Shape {" % (i, extends))
+    for k in range(members):
+        print("  int f%d_%d;" % (i, k))
+    for k in range(members):
+        print("  int g%d_%d(int x) { return x + f%d_%d; }" % (i, k, i, k))
+    print("  int area() { return f0_0 + f%d_0 + g0_1(f%d_1); }" % (i // 2, i))
+    print("}")
+print("void main() { C%d c; c = New(C%d); Print(c.area()); }" % (depth - 1, depth - 1))
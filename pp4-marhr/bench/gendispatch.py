@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+# File: gendispatch.py
+# --------------------
+# Writes a Decaf program that keeps the checker testing what kind of
+# node it has: fields and calls through this and other objects inside
+# nested loops, inherited down short chains of classes, and breaks. It is
+# the input for timing the check pass (see isa<> and cast<> in ast.h).
+# The parse can be taken out of the timing with the tree cache, written
+# by the first run:
+#
+#     bench/gendispatch.py 400 > dispatch.decaf
+#     ./dcc --ast-cache dispatch.cache < dispatch.decaf
+#     bench/timedcc.py 5 dispatch.decaf ./dcc --ast-cache dispatch.cache
+#     ./dcc --ast-cache dispatch.cache --time-passes < dispatch.decaf
+#
+# The arguments are the number of classes (400 if not given), in chains
+# of 10, and the number of methods each one has (8 if not given).
+
+import sys
+
+classes = int(sys.argv[1]) if len(sys.argv) > 1 else 400
+methods = int(sys.argv[2]) if len(sys.argv) > 2 else 8
+
+
+def body():
+    step = ("x = x + k; y = this.get(i) + area(); "
+            "s = next.get(i) + a.length() + other.height(); "
+            "if (x < y) { y = s; } while (y > s) break; "
+            "while (i < k) { x = next.area(); h = this.get(x); a[i] = x; i = i + 1; } ")
+    return ("    while (i < k) { for (i = 0; i < k; i = i + 1) { if (s > 0) { %s} } }"
+            % (step * 6))
+
+
+print("interface Shape { int area(); }")
+for c in range(classes):
+    top = c - c % 10
+    if c == top:
+        print("class C%d implements Shape {" % c)
+        print("  int x; int y; int h; int[] a; C%d next; C%d other;" % (c, c))
+        print("  int area() { return x * y; }")
+        print("  int get(int i) { return a[i]; }")
+        print("  int height() { return h + y; }")
+    else:
+        print("class C%d extends C%d {" % (c, c - 1))
+        print("  int area() { return x * y + this.get(0); }")
+    for m in range(methods):
+        print("  void m%d_%d(int k) {" % (c, m))
+        print("    int i; int s;")
+        print(body())
+        print("  }")
+    print("}")
+print("void main() { Print(0); }")
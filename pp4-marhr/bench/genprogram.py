@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# File: genprogram.py
+# -------------------
+# Writes a large Decaf program for timing the checker: the given number
+# of classes, each with a field, a couple of methods and some arithmetic,
+# and as many global functions with loops and a call each. With 3000 (the
+# default) it is 60k lines long and is the input the checker's timings
+# are usually quoted on:
+#
+#     bench/genprogram.py > big.decaf
+#     bench/timedcc.py 5 big.decaf ./dcc
+#
+# A second argument gives the first class that many more methods, so a
+# good part of the checking is in one class, to see how -j spreads it:
+#
+#     bench/genprogram.py 1000 3000 > skewed.decaf
+#     ./dcc -j 4 -d passes < skewed.decaf
+
+import sys
+
+n = int(sys.argv[1]) if len(sys.argv) > 1 else 3000
+extra = int(sys.argv[2]) if len(sys.argv) > 2 else 0
+
+
+def method(name, c):
+    return ["  int %s(int a, int b) {" % name,
+            "    int x;",
+            "    int y;",
+            "    x = a + b * 2 - a % 3;",
+            "    y = " + " + ".join("x" for _ in range(40)) + ";",
+            "    while (x < 10) { x = x + 1; }",
+            "    if (x == y) { return x; } else { return y; }",
+            "  }"]
+
+
+out = ["interface Shape { int Area(); }"]
+for c in range(n):
+    extends = " extends C%d" % (c - 1) if c > 0 and c % 10 else ""
+    out.append("class C%d%s implements Shape {" % (c, extends))
+    out.append("  int f%d;" % c)
+    out.append("  int Area() { return f%d; }" % c)
+    out += method("M%d" % c, c)
+    if c == 0:
+        for k in range(extra):
+            out += method("N%d" % k, c)
+    out.append("}")
+for f in range(n):
+    out.append("int G%d(int a) {" % f)
+    out.append("  int i; double d; bool b;")
+    out.append("  i = a * 3 + (a - 1) * (a + 2);")
+    out.append("  d = 1.5 * 2.5;")
+    out.append("  b = i < a && a >= 0 || !(i == a);")
+    out.append("  for (i = 0; i < 10; i = i + 1) { a = a + i; }")
+    out.append("  return G%d(a) + i;" % max(f - 1, 0))
+    out.append("}")
+out.append("void main() { C0 c; int z; z = G0(3); Print(z); }")
+print("\n".join(out))
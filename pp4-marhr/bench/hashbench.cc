@@ -0,0 +1,81 @@
+/* File: hashbench.cc
+ * ------------------
+ * Micro-benchmark for Hashtable (see hashtable.h). For each table size
+ * given on the command line (10k, 100k and 1M keys if none are), it
+ * interns that many distinct names, then times entering them all in one
+ * table, looking each one up three times, looking up as many names that
+ * are not in the table, and removing them all again.
+ *
+ *     make hashbench && ./hashbench 10000 100000 1000000
+ *
+ * It only uses the public interface of the table, so the same file can
+ * be built against an older hashtable.h to compare the two.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "hashtable.h"
+#include "symbol.h"
+using namespace std;
+
+static double Millis(chrono::steady_clock::time_point start)
+{
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+static void Run(int n)
+{
+    vector<Symbol*> keys(n), missing(n);
+    char name[32];
+    for (int i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "name%d", i);
+        keys[i] = Symbol::Intern(name);
+        snprintf(name, sizeof(name), "other%d", i);
+        missing[i] = Symbol::Intern(name);
+    }
+
+    Hashtable<Symbol*> *table = new Hashtable<Symbol*>;
+    long found = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        table->Enter(keys[i], keys[i]);
+    double enter = Millis(start);
+
+    start = chrono::steady_clock::now();
+    for (int round = 0; round < 3; round++)
+        for (int i = 0; i < n; i++)
+            found += table->Lookup(keys[i]) == keys[i];
+    double hits = Millis(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        found += table->Lookup(missing[i]) != NULL;
+    double misses = Millis(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        table->Remove(keys[i], keys[i]);
+    double removes = Millis(start);
+
+    if (found != 3L*n || table->NumEntries() != 0) {
+        fprintf(stderr, "hashbench: wrong results for %d keys\n", n);
+        exit(1);
+    }
+    printf("%8d keys: enter %8.2f ms  3x hit %8.2f ms  miss %8.2f ms  remove %8.2f ms  total %8.2f ms\n",
+           n, enter, hits, misses, removes, enter + hits + misses + removes);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 1) {
+        Run(10000);
+        Run(100000);
+        Run(1000000);
+    }
+    for (int i = 1; i < argc; i++)
+        Run(atoi(argv[i]));
+    return 0;
+}
@@ -0,0 +1,37 @@
+#!/usr/bin/env python3
+# File: scanbench.py
+# ------------------
+# Measures how fast each compiler given scans, in MB/s. The input is the
+# samples corpus copied over and over to the given size in MB. Each
+# compiler runs it with --stop-after lex and --stop-after read, and the
+# difference in CPU time (the least of 5 runs each) is the scanning time:
+#
+#     make BUILD=release dcc-flex dcc-fast
+#     bench/scanbench.py 50 ./dcc-flex ./dcc-fast
+#
+# make BUILD=release scanbench does the same.
+
+import glob
+import os
+import sys
+import tempfile
+
+from timedcc import time_runs
+
+if len(sys.argv) < 3:
+    sys.exit("usage: scanbench.py <MB> <dcc> [dcc...]")
+size = float(sys.argv[1]) * 1024 * 1024
+here = os.path.dirname(os.path.abspath(__file__))
+corpus = b"".join(open(f, "rb").read()
+                  for f in sorted(glob.glob(os.path.join(here, "..", "samples", "*.decaf"))))
+
+with tempfile.NamedTemporaryFile(suffix=".decaf") as input:
+    for _ in range(int(size // len(corpus)) + 1):
+        input.write(corpus)
+    input.flush()
+    mb = os.path.getsize(input.name) / (1024.0 * 1024)
+    for dcc in sys.argv[2:]:
+        lex = time_runs(5, input.name, [dcc, "--stop-after", "lex"])[0][0]
+        read = time_runs(5, input.name, [dcc, "--stop-after", "read"])[0][0]
+        print("%s: %.1f MB in %.3f s, %.0f MB/s"
+              % (os.path.basename(dcc), mb, lex - read, mb / max(lex - read, 1e-6)))
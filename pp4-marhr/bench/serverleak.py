@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# File: serverleak.py
+# -------------------
+# Keeps a compiler server (dcc --server) busy on one program for a long
+# while and prints its resident size after every full compile, to see
+# that the trees it replaces are given back (see CompileAll in
+# server.cc). Each round adds or takes away a blank line at the start of
+# the text, which compiles all of it again, and then makes and undoes
+# the given number of edits inside the first method body that starts
+# on a line of its own, which are handled incrementally:
+#
+#     bench/genprogram.py > big.decaf
+#     bench/serverleak.py ./dcc big.decaf 40
+#
+# The arguments are the compiler, the program, the number of rounds (20
+# if not given) and the number of body edits in each (5 if not given).
+# The size should stay about where it was after the open.
+
+import subprocess, sys
+
+dcc, path = sys.argv[1], sys.argv[2]
+rounds = int(sys.argv[3]) if len(sys.argv) > 3 else 20
+bodyEdits = int(sys.argv[4]) if len(sys.argv) > 4 else 5
+
+text = open(path, 'rb').read()
+server = subprocess.Popen([dcc, '--server'], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+
+def request(command, data=b''):
+    server.stdin.write(command.encode() + b'\n' + data)
+    server.stdin.flush()
+    reply = server.stdout.readline().decode().split()
+    if not reply or reply[0] != 'errors':
+        sys.exit('unexpected reply to %s: %s' % (command, ' '.join(reply)))
+    server.stdout.read(int(reply[1]))
+    return reply[2]
+
+def residentMB():
+    for line in open('/proc/%d/status' % server.pid):
+        if line.startswith('VmRSS:'):
+            return int(line.split()[1]) // 1024
+
+body = text.index(b') {\n') + 4
+print('open: %s, %d MB' % (request('open %d' % len(text), text), residentMB()))
+for i in range(rounds):
+    if i % 2 == 0:
+        how = request('edit 0 0 1', b'\n')
+        body += 1
+    else:
+        how = request('edit 0 1 0')
+        body -= 1
+    for k in range(bodyEdits):
+        request('edit %d %d 7' % (body, body), b'x = 1;\n')
+        request('edit %d %d 0' % (body, body + 7))
+    print('round %d: %s, %d MB' % (i + 1, how, residentMB()), flush=True)
+server.stdin.write(b'quit\n')
+server.stdin.close()
+server.wait()
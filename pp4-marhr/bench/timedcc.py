@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+# File: timedcc.py
+# ----------------
+# Runs a command a number of times with the given file as its standard
+# input (the output is thrown away) and prints the least and the median
+# CPU time (user + system) of the runs, and the largest resident size
+# any run reached. The benchmarks in this directory are timed with it:
+#
+#     bench/timedcc.py 5 input.decaf ./dcc [options...]
+
+import os
+import sys
+
+
+def time_runs(runs, path, command):
+    """Returns the sorted CPU times of the runs and the largest rss in kB."""
+    times, maxrss = [], 0
+    for _ in range(runs):
+        pid = os.fork()
+        if pid == 0:
+            try:
+                os.dup2(os.open(path, os.O_RDONLY), 0)
+                null = os.open(os.devnull, os.O_WRONLY)
+                os.dup2(null, 1)
+                os.dup2(null, 2)
+                os.execvp(command[0], command)
+            finally:
+                os._exit(127)   # not back into the caller's code
+        _, status, usage = os.wait4(pid, 0)
+        if os.WIFEXITED(status) and os.WEXITSTATUS(status) == 127:
+            sys.exit("cannot run %s" % command[0])
+        times.append(usage.ru_utime + usage.ru_stime)
+        maxrss = max(maxrss, usage.ru_maxrss)
+    times.sort()
+    return times, maxrss
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 4:
+        sys.exit("usage: timedcc.py <runs> <input> <command> [args...]")
+    runs, path, command = int(sys.argv[1]), sys.argv[2], sys.argv[3:]
+    times, maxrss = time_runs(runs, path, command)
+    print("%s: min %.3f s  median %.3f s  max rss %d MB"
+          % (os.path.basename(path), times[0], times[len(times) // 2], maxrss // 1024))
@@ -6,38 +6,170 @@
 #include "errors.h"
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <unordered_set>
 #include <stdarg.h>
 #include <stdio.h>
+#include <limits.h>
 using namespace std;
 
-#include "scanner.h" // for GetLineNumbered
+#include "source.h" // for GetLineNumbered
 #include "ast_type.h"
 #include "ast_expr.h"
 #include "ast_stmt.h"
 #include "ast_decl.h"
 
 
-int ReportError::numErrors = 0;
+std::atomic<int> ReportError::numErrors(0);
+bool ReportError::streaming = false, ReportError::unique = false;
+int ReportError::maxErrors = 0;
+vector<ReportError::Message> ReportError::collected;
+std::mutex ReportError::outputLock;
+thread_local vector<ReportError::Message> *ReportError::captured = NULL;
 
-void ReportError::UnderlineErrorInLine(const char *line, yyltype *pos) {
-    if (!line) return;
-    cerr << line << endl;
+void ReportError::UnderlineErrorInLine(ostream &out, SourceLine line, yyltype *pos) {
+    if (!line.text) return;
+    out.write(line.text, line.length) << '\n';
     for (int i = 1; i <= pos->last_column; i++)
-        cerr << (i >= pos->first_column ? '^' : ' ');
-    cerr << endl;
+        out << (i >= pos->first_column ? '^' : ' ');
+    out << '\n';
 }
 
  
  
-void ReportError::OutputError(yyltype *loc, string msg) {
+void ReportError::OutputError(yyltype *loc, string msg, int refLine, size_t refAt) {
     numErrors++;
-    fflush(stdout); // make sure any buffered text has been output
-    if (loc) {
-        cerr << endl << "*** Error line " << loc->first_line << "." << endl;
-        UnderlineErrorInLine(GetLineNumbered(loc->first_line), loc);
+    ostringstream out;
+    if (loc)
+        UnderlineErrorInLine(out, GetLineNumbered(loc->first_line), loc);
+    out << "*** ";
+    refAt += out.tellp();
+    out << msg << "\n\n";
+    Message m = { loc ? loc->first_line : INT_MAX, out.str(), refLine, refAt };
+    if (captured)
+        captured->push_back(m);
+    else
+        Output(m);
+}
+
+string ReportError::Format(const Message &m) {
+    string out;
+    AppendFormatted(out, m);
+    return out;
+}
+
+void ReportError::AppendFormatted(string &out, const Message &m) {
+    out += "\n*** Error";
+    if (m.line != INT_MAX)
+        out += " line " + to_string(m.line);
+    out += ".\n";
+    if (m.refLine) {
+        out.append(m.text, 0, m.refAt);
+        out += to_string(m.refLine);
+        out.append(m.text, m.refAt, string::npos);
     } else
-        cerr << endl << "*** Error." << endl;
-    cerr << "*** " << msg << endl << endl;
+        out += m.text;
+}
+
+
+/* Method: Output
+ * --------------
+ * Prints the message right away when streaming, otherwise keeps it
+ * for Flush.
+ */
+void ReportError::Output(const Message &m) {
+    lock_guard<std::mutex> hold(outputLock);
+    if (!streaming) {
+        collected.push_back(m);
+        return;
+    }
+    string text = Format(m);
+    fflush(stdout); // make sure any buffered text has been output
+    fwrite(text.data(), 1, text.size(), stderr);
+}
+
+
+static bool ByLine(const ReportError::Message *a, const ReportError::Message *b) {
+    return a->line < b->line;
+}
+
+void ReportError::Flush() {
+    lock_guard<std::mutex> hold(outputLock);
+    if (collected.empty()) return;
+    vector<const Message*> list(collected.size());
+    for (size_t i = 0; i < collected.size(); i++)
+        list[i] = &collected[i];
+    string all = FormatAll(list);
+    fflush(stdout);
+    fwrite(all.data(), 1, all.size(), stderr);
+    collected.clear();
+}
+
+/* Method: FormatAll
+ * -----------------
+ * Sorts the messages by line and puts them together as Flush prints
+ * them, leaving out the repeated and the ones over the limit.
+ */
+string ReportError::FormatAll(vector<const Message*> &sorted) {
+    stable_sort(sorted.begin(), sorted.end(), ByLine);
+
+    string all;
+    unordered_set<string> seen;
+    int shown = 0, dropped = 0;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        size_t start = all.size();
+        AppendFormatted(all, *sorted[i]);
+        if (unique && !seen.insert(all.substr(start)).second) {
+            all.resize(start);
+            continue;
+        }
+        if (maxErrors && shown == maxErrors) {
+            all.resize(start);
+            dropped++;
+            continue;
+        }
+        shown++;
+    }
+    if (dropped) {
+        ostringstream s;
+        s << "\n*** " << dropped << " more error" << (dropped == 1 ? "" : "s") << " not shown\n\n";
+        all += s.str();
+    }
+    return all;
+}
+
+
+vector<ReportError::Message> *ReportError::CaptureOutput(vector<Message> *list) {
+    vector<Message> *previous = captured;
+    captured = list;
+    return previous;
+}
+
+void ReportError::OutputCaptured(const vector<Message> &list) {
+    if (captured) {
+        captured->insert(captured->end(), list.begin(), list.end());
+        return;
+    }
+    for (size_t i = 0; i < list.size(); i++)
+        Output(list[i]);
+}
+
+void ReportError::OutputSaved(const vector<Message> &list) {
+    numErrors += list.size();
+    OutputCaptured(list);
+}
+
+string ReportError::FormatOutput(const vector<Message> &list) {
+    if (streaming) {
+        string all;
+        for (size_t i = 0; i < list.size(); i++)
+            AppendFormatted(all, list[i]);
+        return all;
+    }
+    vector<const Message*> sorted(list.size());
+    for (size_t i = 0; i < list.size(); i++)
+        sorted[i] = &list[i];
+    return FormatAll(sorted);
 }
 
 
@@ -80,9 +212,10 @@ void ReportError::UnrecogChar(yyltype *loc, char ch) {
 
 void ReportError::DeclConflict(Decl *decl, Decl *prevDecl) {
     stringstream s;
-    s << "Declaration of '" << decl << "' here conflicts with declaration on line " 
-      << prevDecl->GetLocation()->first_line << '\0';
-    OutputError(decl->GetLocation(), s.str());
+    s << "Declaration of '" << decl << "' here conflicts with declaration on line ";
+    size_t at = s.str().size();
+    s << '\0';
+    OutputError(decl->GetLocation(), s.str(), prevDecl->GetLocation()->first_line, at);
 }
   
 void ReportError::OverrideMismatch(Decl *fnDecl) {
@@ -183,11 +316,11 @@ void ReportError::BreakOutsideLoop(BreakStmt *bStmt) {
  * -------------------
  * Standard error-reporting function expected by yacc. Our version merely
  * just calls into the error reporter above, passing the location of
- * the last token read. If you want to suppress the ordinary "parse error"
+ * the lookahead token. If you want to suppress the ordinary "parse error"
  * message from yacc, you can implement yyerror to do nothing and
  * then call ReportError::Formatted yourself with a more descriptive 
  * message.
  */
-void yyerror(char *msg) {
-    ReportError::Formatted(&yylloc, "%s", msg);
+void yyerror(yyltype *loc, const char *msg) {
+    ReportError::Formatted(loc, "%s", msg);
 }
@@ -13,8 +13,13 @@
 #define _H_errors
 
 #include <string>
+#include <iosfwd>
+#include <vector>
+#include <atomic>
+#include <mutex>
 using std::string;
 #include "location.h"
+#include "source.h"
 class Type;
 class Identifier;
 class Expr;
@@ -33,7 +38,7 @@ class Operator;
  * on this class are static, thus you can invoke methods directly via
  * the class name, e.g.
  *
- *    if (missingEnd) ReportError::UntermString(&yylloc, str);
+ *    if (missingEnd) ReportError::UntermString(loc, str);
  *
  * For some methods, the first argument is the pointer to the location
  * structure that identifies where the problem is (usually this is the
@@ -41,6 +46,13 @@ class Operator;
  * if there is no appropriate position to point out. For other methods,
  * location is accessed by messaging the node in error which is passed
  * as an argument. You cannot pass NULL for these arguments.
+ *
+ * Output: the messages are collected as they are reported and printed
+ * all at once by Flush, ordered by line (messages on the same line stay
+ * in the order they were reported, errors without a location go last).
+ * Optionally repeated messages are dropped and only so many printed.
+ * SetStreaming(true) switches back to printing each error the moment it
+ * is reported, in report order. Reporting is safe from several threads.
  */
 
 
@@ -106,13 +118,67 @@ class ReportError
 
   // Returns number of error messages printed
   static int NumErrors() { return numErrors; }
+
+
+  // Settings for the output (see general notes above). A max of 0
+  // means no limit.
+  static void SetStreaming(bool on)   { streaming = on; }
+  static void SetUnique(bool on)      { unique = on; }
+  static void SetMaxErrors(int max)   { maxErrors = max; }
+
+  // Prints the collected errors, does nothing when streaming
+  static void Flush();
+
+
+  // An error message, with the line it is reported on (INT_MAX if it
+  // has no location). The text is all of the message after the "*** Error
+  // line N." header, which is only added as it is output, so the line
+  // can still be changed (the compiler server moves the errors of code
+  // that is kept along when lines are added or removed above it). The
+  // same goes for a line the text refers to, which is put in at refAt.
+  struct Message {
+    int line;
+    string text;
+    int refLine;     // 0 if none
+    size_t refAt;
+  };
+  static string Format(const Message &m);
+  static void AppendFormatted(string &out, const Message &m);
+
+  // Sorts the list and returns the text Flush would print for it
+  static string FormatAll(std::vector<const Message*> &list);
+
+  // While capturing, the errors reported by the calling thread are
+  // added to list rather than output. Pass NULL to stop. The list that
+  // was capturing before is returned, so a capture can be nested inside
+  // another one and put back after it. OutputCaptured later outputs them
+  // as though they were being reported right then (into the list that
+  // is capturing then, if any). OutputSaved does the same for errors
+  // kept from an earlier run (see astcache.h), which also counts them as
+  // errors of this one.
+  static std::vector<Message> *CaptureOutput(std::vector<Message> *list);
+  static void OutputCaptured(const std::vector<Message> &list);
+  static void OutputSaved(const std::vector<Message> &list);
+
+  // Returns the text outputting the list and then calling Flush would
+  // print (in the order reported when streaming)
+  static string FormatOutput(const std::vector<Message> &list);
   
  private:
 
-  static void UnderlineErrorInLine(const char *line, yyltype *pos);
-  static void OutputError(yyltype *loc, string msg);
-  static int numErrors;
+  static void UnderlineErrorInLine(std::ostream &out, SourceLine line, yyltype *pos);
+  static void OutputError(yyltype *loc, string msg, int refLine = 0, size_t refAt = 0);
+  static void Output(const Message &m);
+  static std::atomic<int> numErrors;
+  static bool streaming, unique;
+  static int maxErrors;
+  static std::vector<Message> collected;
+  static std::mutex outputLock;
+  static thread_local std::vector<Message> *captured;
   
 };
 
+// The error-reporting function the parser calls, see errors.cc
+void yyerror(yyltype *loc, const char *msg);
+
 #endif
@@ -0,0 +1,451 @@
+/* File: fastscanner.cc
+ * --------------------
+ * A hand-written scanner that can be built in place of the flex scanner
+ * (make SCANNER=fast). It follows the rules of scanner.l exactly, longest
+ * match first and the earlier rule on a tie, and hands the parser the
+ * same tokens with the same values and locations, and reports the same
+ * errors. It scans the source buffer in place (see source.h) instead of
+ * having it copied into a flex buffer, looks keywords up with a perfect
+ * hash instead of trying a rule per keyword, and skips whitespace and
+ * comment bodies in runs rather than one action per character (with
+ * SIMD compares where available, see "Skipping runs" below).
+ *
+ * The text of a token is only copied out for the tokens that need it
+ * (numbers, strings and the error cases). make scanbench times the two
+ * scanners against each other.
+ */
+
+#include <string.h>
+#include <string>
+#include "scanner.h"
+#include "utility.h"
+#include "trace.h" // for PrintDebug()
+#include "errors.h"
+#include "parser.h" // for token codes, YYSTYPE
+#include "source.h"
+
+struct Scanner::State {
+    const char *text, *cur, *textEnd;  // the source and the scan position
+    int lineNum, colNum;
+    bool inComment;
+    std::string tokenText;
+    YYSTYPE *value;                    // of the token being scanned
+    yyltype *loc;
+};
+
+
+/* Character classes
+ * -----------------
+ * One table lookup per character decides which of these it is.
+ */
+enum { Alpha = 1, Digit = 2, HexDigit = 4, IdentChar = 8, Operator = 16 };
+static unsigned char charClass[256];
+
+static void InitCharClasses()
+{
+    for (int c = 'a'; c <= 'z'; c++) charClass[c] |= Alpha | IdentChar;
+    for (int c = 'A'; c <= 'Z'; c++) charClass[c] |= Alpha | IdentChar;
+    for (int c = '0'; c <= '9'; c++) charClass[c] |= Digit | HexDigit | IdentChar;
+    for (int c = 'a'; c <= 'f'; c++) charClass[c] |= HexDigit;
+    for (int c = 'A'; c <= 'F'; c++) charClass[c] |= HexDigit;
+    charClass['_'] |= IdentChar;
+    for (const char *p = "-+/*%=.,;:!<>()[]{}"; *p; p++)
+        charClass[(unsigned char)*p] |= Operator;
+}
+
+static inline bool Is(const char *p, const char *end, int cls)
+{
+    return p < end && (charClass[(unsigned char)*p] & cls);
+}
+
+
+/* Keywords
+ * --------
+ * The keywords (and true/false, which scanner.l also matches ahead of
+ * the identifier rule) are placed in a 64 entry table by a hash of the
+ * length and first and last characters, chosen so no two of them
+ * collide. A word is a keyword if the entry it hashes to is that word.
+ */
+struct Keyword {
+    const char *name;
+    int length;
+    int token;
+};
+
+static Keyword keywords[] = {
+    {"void", 4, T_Void}, {"int", 3, T_Int}, {"double", 6, T_Double},
+    {"bool", 4, T_Bool}, {"string", 6, T_String}, {"null", 4, T_Null},
+    {"class", 5, T_Class}, {"extends", 7, T_Extends}, {"this", 4, T_This},
+    {"interface", 9, T_Interface}, {"implements", 10, T_Implements},
+    {"while", 5, T_While}, {"for", 3, T_For}, {"if", 2, T_If},
+    {"else", 4, T_Else}, {"return", 6, T_Return}, {"break", 5, T_Break},
+    {"New", 3, T_New}, {"NewArray", 8, T_NewArray}, {"Print", 5, T_Print},
+    {"ReadInteger", 11, T_ReadInteger}, {"ReadLine", 8, T_ReadLine},
+    {"true", 4, T_BoolConstant}, {"false", 5, T_BoolConstant},
+};
+
+static const int KeywordTableSize = 64;
+static Keyword *keywordTable[KeywordTableSize];
+
+static inline int KeywordHash(const char *s, int len)
+{
+    return (6*len + (unsigned char)s[0] + 21*(unsigned char)s[len-1]) & (KeywordTableSize-1);
+}
+
+static void InitKeywords()
+{
+    for (size_t i = 0; i < sizeof(keywords)/sizeof(keywords[0]); i++) {
+        int h = KeywordHash(keywords[i].name, keywords[i].length);
+        Assert(keywordTable[h] == NULL);
+        keywordTable[h] = &keywords[i];
+    }
+}
+
+static inline Keyword *FindKeyword(const char *s, int len)
+{
+    if (len < 2 || len > 11) return NULL;
+    Keyword *k = keywordTable[KeywordHash(s, len)];
+    return (k && k->length == len && !memcmp(k->name, s, len)) ? k : NULL;
+}
+
+
+/* Function: InitScanner
+ * ---------------------
+ * Reads the whole input into the source buffer.
+ */
+void InitScanner()
+{
+    PrintDebug(kTraceLex, "Initializing scanner");
+    ReadSource(stdin);
+}
+
+// The tables are filled in by whichever thread makes the first Scanner,
+// the others wait for it to finish.
+Scanner::Scanner() : state(new State)
+{
+    static bool tablesReady = (InitCharClasses(), InitKeywords(), true);
+    size_t size;
+    GetSourceText(&size);
+    Restart(0, size, 1, 1);
+}
+
+Scanner::~Scanner()
+{
+    delete state;
+}
+
+void Scanner::Restart(size_t offset, size_t end, int line, int column)
+{
+    State &s = *state;
+    size_t size;
+    s.text = GetSourceText(&size);
+    Assert(offset <= end && end <= size);
+    s.cur = s.text + offset;
+    s.textEnd = s.text + end;
+    s.lineNum = line;
+    s.colNum = column;
+    s.inComment = false;
+}
+
+
+/* Function: Match
+ * ---------------
+ * Consumes the next len characters as one match, recording its location
+ * and updating the column counter (what DoBeforeEachAction does for the
+ * flex scanner).
+ */
+static inline void Match(Scanner::State &s, int len)
+{
+    s.loc->first_line = s.lineNum;
+    s.loc->first_column = s.colNum;
+    s.loc->last_line = s.lineNum;
+    s.loc->last_column = s.colNum + len - 1;
+    s.colNum += len;
+    s.cur += len;
+}
+
+/* Function: MatchEach
+ * -------------------
+ * Consumes len characters that flex would match one at a time, leaving
+ * the location of the last one, as flex would.
+ */
+static inline void MatchEach(Scanner::State &s, int len)
+{
+    s.colNum += len - 1;
+    s.cur += len - 1;
+    Match(s, 1);
+}
+
+static char *SetText(Scanner::State &s, const char *start, int len)
+{
+    s.tokenText.assign(start, len);
+    return &s.tokenText[0];
+}
+
+
+/* Skipping runs
+ * -------------
+ * Most of the input is spaces, comment text and identifiers, so the runs
+ * of those are measured a block of bytes at a time: each byte of the
+ * block is compared at once, and the first one that ends the run is
+ * found from the bit mask of the comparison. AVX2 is used when the
+ * compiler targets it (make SIMD=avx2), otherwise SSE2, which every
+ * x86-64 has. Elsewhere, and for the last partial block, the loops go
+ * one character at a time. A run never crosses a tab or a newline, so
+ * the column bookkeeping is done for those one at a time as before.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+typedef __m256i Block;
+static const int BlockSize = 32;
+static inline Block Load(const char *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline Block Splat(char c) { return _mm256_set1_epi8(c); }
+static inline Block Eq(Block a, Block b) { return _mm256_cmpeq_epi8(a, b); }
+static inline Block Gt(Block a, Block b) { return _mm256_cmpgt_epi8(a, b); }
+static inline Block And(Block a, Block b) { return _mm256_and_si256(a, b); }
+static inline Block Or(Block a, Block b) { return _mm256_or_si256(a, b); }
+static inline unsigned Mask(Block b) { return _mm256_movemask_epi8(b); }
+#define HAVE_BLOCKS
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128i Block;
+static const int BlockSize = 16;
+static inline Block Load(const char *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline Block Splat(char c) { return _mm_set1_epi8(c); }
+static inline Block Eq(Block a, Block b) { return _mm_cmpeq_epi8(a, b); }
+static inline Block Gt(Block a, Block b) { return _mm_cmpgt_epi8(a, b); }
+static inline Block And(Block a, Block b) { return _mm_and_si128(a, b); }
+static inline Block Or(Block a, Block b) { return _mm_or_si128(a, b); }
+static inline unsigned Mask(Block b) { return _mm_movemask_epi8(b); }
+#define HAVE_BLOCKS
+#endif
+
+#ifdef HAVE_BLOCKS
+static const unsigned FullMask = (unsigned)((1ull << BlockSize) - 1);
+
+// bytes in [lo, hi], both in 0..126 (the compare is signed, bytes
+// of 128 and up are negative and so are never in range)
+static inline Block InRange(Block v, char lo, char hi)
+{
+    return And(Gt(v, Splat(lo - 1)), Gt(Splat(hi + 1), v));
+}
+#endif
+
+/* Function: SkipSpaces
+ * --------------------
+ * Returns the first character from p on that is not a space.
+ */
+static inline const char *SkipSpaces(const char *p, const char *textEnd)
+{
+#ifdef HAVE_BLOCKS
+    for (; p + BlockSize <= textEnd; p += BlockSize) {
+        unsigned stop = ~Mask(Eq(Load(p), Splat(' '))) & FullMask;
+        if (stop) return p + __builtin_ctz(stop);
+    }
+#endif
+    while (p < textEnd && *p == ' ') p++;
+    return p;
+}
+
+/* Function: SkipIdentChars
+ * ------------------------
+ * Returns the first character from p on that is not a letter, digit or
+ * underscore.
+ */
+static inline const char *SkipIdentChars(const char *p, const char *textEnd)
+{
+#ifdef HAVE_BLOCKS
+    for (; p + BlockSize <= textEnd; p += BlockSize) {
+        Block v = Load(p);
+        Block lower = Or(v, Splat(0x20));   // folds A-Z onto a-z
+        Block ident = Or(Or(InRange(lower, 'a', 'z'), InRange(v, '0', '9')),
+                         Eq(v, Splat('_')));
+        unsigned stop = ~Mask(ident) & FullMask;
+        if (stop) return p + __builtin_ctz(stop);
+    }
+#endif
+    while (p < textEnd && (charClass[(unsigned char)*p] & IdentChar)) p++;
+    return p;
+}
+
+/* Function: SkipCommentText
+ * -------------------------
+ * Returns the first newline, tab or '*' from p on, or the end.
+ */
+static inline const char *SkipCommentText(const char *p, const char *textEnd)
+{
+#ifdef HAVE_BLOCKS
+    for (; p + BlockSize <= textEnd; p += BlockSize) {
+        Block v = Load(p);
+        unsigned stop = Mask(Or(Or(Eq(v, Splat('\n')), Eq(v, Splat('\t'))), Eq(v, Splat('*'))));
+        if (stop) return p + __builtin_ctz(stop);
+    }
+#endif
+    while (p < textEnd && *p != '\n' && *p != '\t' && *p != '*') p++;
+    return p;
+}
+
+
+/* Function: CommentRun
+ * --------------------
+ * Returns how many characters from p on are plain comment text, which
+ * flex would match one at a time with <COMM>. and nothing else: anything
+ * but newline, tab, and a '*' that starts the end of the comment.
+ */
+static inline int CommentRun(const char *p, const char *textEnd)
+{
+    const char *q = p;
+    for (;;) {
+        q = SkipCommentText(q, textEnd);
+        if (q < textEnd && *q == '*' && !(q + 1 < textEnd && q[1] == '/'))
+            q++;                // a '*' on its own is comment text too
+        else
+            return q - p;
+    }
+}
+
+
+/* Function: ScanNumber
+ * --------------------
+ * Matches the longest of {INTEGER}, {HEX_INTEGER} and {DOUBLE} and fills
+ * in the value.
+ */
+static int ScanNumber(Scanner::State &s)
+{
+    const char *start = s.cur, *p = s.cur, *textEnd = s.textEnd;
+    if (p[0] == '0' && p + 2 < textEnd && (p[1] == 'x' || p[1] == 'X') && Is(p + 2, textEnd, HexDigit)) {
+        p += 3;
+        while (Is(p, textEnd, HexDigit)) p++;
+        Match(s, p - start);
+        s.value->integerConstant = strtol(SetText(s, start, p - start), NULL, 16);
+        return T_IntConstant;
+    }
+    while (Is(p, textEnd, Digit)) p++;
+    if (p < textEnd && *p == '.') {
+        p++;
+        while (Is(p, textEnd, Digit)) p++;
+        if (p < textEnd && (*p == 'E' || *p == 'e')) {
+            const char *e = p + 1;
+            if (e < textEnd && (*e == '+' || *e == '-')) e++;
+            if (Is(e, textEnd, Digit)) {
+                while (Is(e, textEnd, Digit)) e++;
+                p = e;
+            }
+        }
+        Match(s, p - start);
+        s.value->doubleConstant = atof(SetText(s, start, p - start));
+        return T_DoubleConstant;
+    }
+    Match(s, p - start);
+    s.value->integerConstant = strtol(SetText(s, start, p - start), NULL, 10);
+    return T_IntConstant;
+}
+
+
+/* Method: NextToken
+ * -----------------
+ * Returns the next token, 0 at the end of the input.
+ */
+int Scanner::NextToken(YYSTYPE *value, yyltype *loc)
+{
+    State &s = *state;
+    const char *&cur = s.cur, *textEnd = s.textEnd;
+    s.value = value;
+    s.loc = loc;
+    for (;;) {
+        if (cur >= textEnd) {
+            if (s.inComment)
+                ReportError::UntermComment();
+            return 0;
+        }
+        const char *start = cur;
+        char c = *cur;
+
+        if (c == '\n') {
+            Match(s, 1);
+            s.lineNum++;
+            s.colNum = 1;
+            AddLineStart(cur - s.text);
+            continue;
+        }
+        if (c == '\t') {
+            Match(s, 1);
+            s.colNum += TAB_SIZE - s.colNum%TAB_SIZE + 1;
+            continue;
+        }
+        if (s.inComment) {
+            int n = CommentRun(cur, textEnd);
+            if (n > 0) {
+                MatchEach(s, n);
+            } else {            // at the */ that ends it
+                Match(s, 2);
+                s.inComment = false;
+            }
+            continue;
+        }
+
+        unsigned char cls = charClass[(unsigned char)c];
+        if (cls & Alpha) {
+            const char *p = SkipIdentChars(cur + 1, textEnd);
+            int len = p - start;
+            Match(s, len);
+            Keyword *k = FindKeyword(start, len);
+            if (k) {
+                if (k->token == T_BoolConstant)
+                    s.value->boolConstant = (start[0] == 't');
+                return k->token;
+            }
+            if (len > MaxIdentLen)
+                ReportError::LongIdentifier(s.loc, SetText(s, start, len));
+            s.value->identifier = Symbol::Intern(start, len > MaxIdentLen ? MaxIdentLen : len);
+            return T_Identifier;
+        }
+        if (cls & Digit)
+            return ScanNumber(s);
+
+        const char *next = cur + 1 < textEnd ? cur + 1 : NULL;
+        switch (c) {
+          case ' ': {
+            Match(s, SkipSpaces(cur + 1, textEnd) - start);
+            continue;
+          }
+          case '"': {
+            const char *p = cur + 1;
+            while (p < textEnd && *p != '"' && *p != '\n') p++;
+            if (p < textEnd && *p == '"') {
+                Match(s, p + 1 - start);
+                s.value->stringConstant = strdup(SetText(s, start, p + 1 - start));
+                return T_StringConstant;
+            }
+            Match(s, p - start);
+            ReportError::UntermString(s.loc, SetText(s, start, p - start));
+            continue;
+          }
+          case '/':
+            if (next && *next == '*') {
+                Match(s, 2);
+                s.inComment = true;
+                continue;
+            }
+            if (next && *next == '/') {
+                const char *p = (const char *)memchr(cur, '\n', textEnd - cur);
+                Match(s, (p ? p : textEnd) - start);
+                continue;
+            }
+            break;
+          case '<': if (next && *next == '=') { Match(s, 2); return T_LessEqual; }    break;
+          case '>': if (next && *next == '=') { Match(s, 2); return T_GreaterEqual; } break;
+          case '=': if (next && *next == '=') { Match(s, 2); return T_Equal; }        break;
+          case '!': if (next && *next == '=') { Match(s, 2); return T_NotEqual; }     break;
+          case '&': if (next && *next == '&') { Match(s, 2); return T_And; }          break;
+          case '|': if (next && *next == '|') { Match(s, 2); return T_Or; }           break;
+          case '+': if (next && *next == '+') { Match(s, 2); return T_MinMin; }       break;
+          case '-': if (next && *next == '-') { Match(s, 2); return T_PlusPlus; }     break;
+          case '[': if (next && *next == ']') { Match(s, 2); return T_Dims; }         break;
+        }
+        Match(s, 1);
+        if (cls & Operator)
+            return c;
+        ReportError::UnrecogChar(s.loc, c);
+    }
+}
@@ -1,45 +1,165 @@
 /* File: hashtable.cc
  * ------------------
- * Implementation of Hashtable class.
+ * Implementation of Hashtable class. The table uses linear probing over
+ * a power-of-two sized array of slots and is kept at most half full, so
+ * a probe sequence, hit or miss, is short. Removing a key shifts the rest
+ * of its probe run back instead of leaving a tombstone behind. Each slot
+ * holds the lastmost value for its key, older (shadowed) values hang off
+ * it in a chain kept in the shadows vector.
  */
-   
+
+#include <algorithm>
+#include <string.h>
+
+static const int InitialCapacity = 16;
+
+template <class Value> Hashtable<Value>::Hashtable()
+{
+  capacity = InitialCapacity;
+  slots = NewSlots(capacity);
+  numKeys = numEntries = 0;
+  freeShadow = -1;
+}
+
+template <class Value> typename Hashtable<Value>::Slot *Hashtable<Value>::NewSlots(int n)
+{
+  Slot *s = (Slot *)TreeArena().Alloc(n * sizeof(Slot));
+  for (int i = 0; i < n; i++)
+    s[i].key = NULL;
+  return s;
+}
+
+
+/* Hashtable::FindSlot
+ * -------------------
+ * Returns the index of the slot holding key, or if key is not in the
+ * table, the index of the empty slot where it would go.
+ */
+template <class Value> int Hashtable<Value>::FindSlot(Symbol *key) const
+{
+  int mask = capacity - 1;
+  int i = key->GetHash() & mask;
+  while (slots[i].key != NULL && slots[i].key != key)
+    i = (i + 1) & mask;
+  return i;
+}
+
+template <class Value> void Hashtable<Value>::Grow()
+{
+  Slot *old = slots;
+  int oldCapacity = capacity;
+  capacity *= 2;
+  slots = NewSlots(capacity);
+  for (int i = 0; i < oldCapacity; i++)
+    if (old[i].key)
+      slots[FindSlot(old[i].key)] = old[i];
+}
+
+
+/* Hashtable::RemoveSlot
+ * ---------------------
+ * Empties the slot at index, then moves back any later entry of the same
+ * probe run that could no longer be reached across the hole.
+ */
+template <class Value> void Hashtable<Value>::RemoveSlot(int index)
+{
+  int mask = capacity - 1;
+  int hole = index;
+  for (int i = (hole + 1) & mask; slots[i].key != NULL; i = (i + 1) & mask) {
+    int home = slots[i].key->GetHash() & mask;
+    // the entry may fill the hole if its home is not cyclically in (hole, i]
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      slots[hole] = slots[i];
+      hole = i;
+    }
+  }
+  slots[hole].key = NULL;
+  numKeys--;
+}
+
+template <class Value> int Hashtable<Value>::NewShadow(Value value, int older)
+{
+  Shadow s = { value, older };
+  if (freeShadow == -1) {
+    shadows.push_back(s);
+    return shadows.size() - 1;
+  }
+  int index = freeShadow;
+  freeShadow = shadows[index].older;
+  shadows[index] = s;
+  return index;
+}
+
+template <class Value> void Hashtable<Value>::FreeShadow(int index)
+{
+  shadows[index].older = freeShadow;
+  freeShadow = index;
+}
+
 
 /* Hashtable::Enter
  * ----------------
  * Stores new value for given identifier. If the key already
  * has an entry and flag is to overwrite, will remove previous entry first,
- * otherwise it just adds another entry under same key. Copies the
- * key, so you don't have to worry about its allocation.
+ * otherwise it just adds another entry under same key. Symbols are
+ * never freed, so the key is stored as is.
  */
-template <class Value> void Hashtable<Value>::Enter(const char *key, Value val, bool overwrite)
+template <class Value> void Hashtable<Value>::Enter(Symbol *key, Value val, bool overwrite)
 {
-  Value prev;
-  if (overwrite && (prev = Lookup(key)))
-    Remove(key, prev);
-  mmap.insert(std::make_pair(strdup(key), val));
+  int i = FindSlot(key);
+  if (slots[i].key == NULL) {
+    if (2*(numKeys + 1) > capacity) {
+      Grow();
+      i = FindSlot(key);
+    }
+    slots[i].key = key;
+    slots[i].value = val;
+    slots[i].older = -1;
+    numKeys++;
+    numEntries++;
+  } else if (overwrite) {
+    slots[i].value = val;
+  } else {
+    slots[i].older = NewShadow(slots[i].value, slots[i].older);
+    slots[i].value = val;
+    numEntries++;
+  }
 }
 
- 
+
 /* Hashtable::Remove
  * -----------------
  * Removes a given key-value pair from table. If no such pair, no
  * changes are made.  Does not affect any other entries under that key.
  */
-template <class Value> void Hashtable<Value>::Remove(const char *key, Value val)
+template <class Value> void Hashtable<Value>::Remove(Symbol *key, Value val)
 {
-  if (mmap.count(key) == 0) // no matches at all
+  int i = FindSlot(key);
+  if (slots[i].key == NULL) // no matches at all
     return;
 
-  typename std::multimap<const char *, Value>::iterator itr;
-  itr = mmap.find(key); // start at first occurrence
-  while (itr != mmap.upper_bound(key)) {
-    if (itr->second == val) { // iterate to find matching pair
-	mmap.erase(itr);
-	break;
+  if (slots[i].value == val) {
+    int older = slots[i].older;
+    if (older == -1) {
+      RemoveSlot(i);
+    } else {                 // the value it shadowed moves up
+      slots[i].value = shadows[older].value;
+      slots[i].older = shadows[older].older;
+      FreeShadow(older);
+    }
+    numEntries--;
+    return;
+  }
+  for (int *link = &slots[i].older; *link != -1; link = &shadows[*link].older) {
+    if (shadows[*link].value == val) {
+      int found = *link;
+      *link = shadows[found].older;
+      FreeShadow(found);
+      numEntries--;
+      return;
     }
-    ++itr;
   }
-} 
+}
 
 
 /* Hashtable::Lookup
@@ -47,23 +167,10 @@ template <class Value> void Hashtable<Value>::Remove(const char *key, Value val)
  * Returns the value earlier stored under key or NULL
  *if there is no matching entry
  */
-template <class Value> Value Hashtable<Value>::Lookup(const char *key) 
+template <class Value> Value Hashtable<Value>::Lookup(Symbol *key)
 {
-  Value found = NULL;
-  
-  if (mmap.count(key) > 0) {
-    typename std::multimap<const char *, Value>::iterator cur, last, prev;
-    cur = mmap.find(key); // start at first occurrence
-    last = mmap.upper_bound(key);
-    while (cur != last) { // iterate to find last entered
-	prev = cur; 
-	if (++cur == mmap.upper_bound(key)) { // have to go one too far
-	  found = prev->second; // one before last was it
-	  break;
-	}
-    }
-  }
-  return found;
+  int i = FindSlot(key);
+  return slots[i].key ? slots[i].value : NULL;
 }
 
 
@@ -72,18 +179,40 @@ template <class Value> Value Hashtable<Value>::Lookup(const char *key)
  */
 template <class Value> int Hashtable<Value>::NumEntries() const
 {
-  return mmap.size();
+  return numEntries;
 }
 
 
+struct ltname {
+  bool operator()(Symbol *s1, Symbol *s2) const
+  { return strcmp(s1->GetName(), s2->GetName()) < 0; }
+};
 
 /* Hashtable:GetIterator
  * ---------------------
  * Returns iterator which can be used to walk through all values in table.
+ * The keys are sorted alphabetically here, values under the same key come
+ * out in the order they were entered.
  */
-template <class Value> Iterator<Value> Hashtable<Value>::GetIterator() 
+template <class Value> Iterator<Value> Hashtable<Value>::GetIterator()
 {
-  return Iterator<Value>(mmap);
+  std::vector<Symbol*> keys;
+  for (int i = 0; i < capacity; i++)
+    if (slots[i].key)
+      keys.push_back(slots[i].key);
+  std::sort(keys.begin(), keys.end(), ltname());
+
+  Iterator<Value> iter;
+  iter.values.reserve(numEntries);
+  for (size_t k = 0; k < keys.size(); k++) {
+    const Slot &slot = slots[FindSlot(keys[k])];
+    size_t first = iter.values.size();
+    iter.values.push_back(slot.value);
+    for (int s = slot.older; s != -1; s = shadows[s].older)
+      iter.values.push_back(shadows[s].value);
+    std::reverse(iter.values.begin() + first, iter.values.end());
+  }
+  return iter;
 }
 
 
@@ -94,6 +223,5 @@ template <class Value> Iterator<Value> Hashtable<Value>::GetIterator()
  */
 template <class Value> Value Iterator<Value>::GetNextValue()
 {
-  return (cur == end ? NULL : (*cur++).second);
+  return (cur == values.size() ? NULL : values[cur++]);
 }
-
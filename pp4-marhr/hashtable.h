@@ -1,14 +1,15 @@
 /* File: hashtable.h
  * -----------------
- * This is a simple table for storing values associated with a string
- * key, supporting simple operations for Enter and Lookup.  It is not
- * much more than a thin cover over the STL associative map container,
- * but hides the awkward C++ template syntax and provides a more
- * familiar interface.
+ * This is a simple table for storing values associated with a symbol
+ * key, supporting simple operations for Enter and Lookup.  It is a flat
+ * open-addressing hash table: the entries sit in one array and a key is
+ * found by probing forward from the slot picked by its hash, so a lookup
+ * touches a slot or two instead of walking a tree.
  *
- * The keys are always strings, but the values can be of any type
- * (ok, that's actually kind of a fib, it expects the type to be
- * some sort of pointer to conform to using NULL for "not found").
+ * The keys are always interned symbols (see symbol.h), so comparing two
+ * keys is a pointer compare and the hash is precomputed. The values can
+ * be of any type (ok, that's actually kind of a fib, it expects the type
+ * to be some sort of pointer to conform to using NULL for "not found").
  * The typename for a Hashtable includes the value type in angle
  * brackets, e.g.  if the table is storing  char *as values, you
  * would use the type name Hashtable<char*>. If storing values
@@ -16,9 +17,15 @@
  * The same notation is used on the matching iterator for the table,
  * i.e. a Hashtable<char*> supports an Iterator<char*>.
  *
- * An iterator is provided for iterating over the entries in a table. 
+ * A table and its slots are allocated from the tree arena (see arena.h),
+ * like the scopes that hold them. The slots outgrown when the table
+ * grows are left in the arena until it is released.
+ *
+ * An iterator is provided for iterating over the entries in a table.
  * The iterator walks through the values, one by one, in alphabetical
- * order by the key. Sample iteration usage:
+ * order by the key (the entries are sorted when the iterator is made,
+ * so iterating is meant for the occasional walk, not for lookups).
+ * Sample iteration usage:
  *
  *       void PrintNames(Hashtable<Decl*> *table)
  *       {
@@ -33,48 +40,71 @@
 #ifndef _H_hashtable
 #define _H_hashtable
 
-#include <map>
-#include <string.h>
-
-struct ltstr {
-  bool operator()(const char* s1, const char* s2) const
-  { return strcmp(s1, s2) < 0; }
-};
+#include <vector>
+#include <stdlib.h>   // for NULL
+#include "symbol.h"
+#include "arena.h"
 
 
 template <class Value> class Iterator;
 
 template<class Value> class Hashtable {
 
-  private: 
-     std::multimap<const char*, Value, ltstr> mmap;
- 
+  private:
+     struct Slot {
+       Symbol *key;   // NULL if the slot is empty
+       Value value;   // lastmost entered value for key
+       int older;     // index into shadows of the value it shadows, or -1
+     };
+     struct Shadow {
+       Value value;
+       int older;     // next older value, or -1 (also links the free list)
+     };
+
+     Slot *slots;
+     int capacity, numKeys, numEntries;
+     std::vector<Shadow, ArenaAllocator<Shadow> > shadows;
+     int freeShadow;
+
+     Slot *NewSlots(int n);
+     int FindSlot(Symbol *key) const;
+     void Grow();
+     void RemoveSlot(int index);
+     int NewShadow(Value value, int older);
+     void FreeShadow(int index);
+
+     Hashtable(const Hashtable&);             // the slots are not owned by
+     Hashtable &operator=(const Hashtable&);  // one copy, so tables are not copied
+
    public:
             // ctor creates a new empty hashtable
-     Hashtable() {}
+     Hashtable();
+
+     static void *operator new(size_t size) { return TreeArena().Alloc(size); }
+     static void operator delete(void *) {} // released along with the arena
 
            // Returns number of entries currently in table
      int NumEntries() const;
 
            // Associates value with key. If a previous entry for
-           // key exists, the bool parameter controls whether 
+           // key exists, the bool parameter controls whether
            // new value overwrites the previous (removing it from
            // from the table entirely) or just shadows it (keeps previous
            // and adds additional entry). The lastmost entered one for an
            // key will be the one returned by Lookup.
-     void Enter(const char *key, Value value,
+     void Enter(Symbol *key, Value value,
 		    bool overwriteInsteadOfShadow = true);
 
            // Removes a given key->value pair.  Any other values
            // for that key are not affected. If this is the last
            // remaining value for that key, the key is removed
            // entirely.
-     void Remove(const char *key, Value value);
+     void Remove(Symbol *key, Value value);
 
           // Returns value stored under key or NULL if no match.
           // If more than one value for key (ie shadow feature was
           // used during Enter), returns the lastmost entered one.
-     Value Lookup(const char *key);
+     Value Lookup(Symbol *key);
 
           // Returns an Iterator object (see below) that can be used to
           // visit each value in the table in alphabetical order.
@@ -91,9 +121,9 @@ template<class Value> class Iterator {
   friend class Hashtable<Value>;
 
   private:
-    typename std::multimap<const char*, Value , ltstr>::iterator cur, end;
-    Iterator(std::multimap<const char*, Value, ltstr>& t)
-      : cur(t.begin()), end(t.end()) {}
+    std::vector<Value> values;
+    size_t cur;
+    Iterator() : cur(0) {}
 
   public:
          // Returns current value and advances iterator to next.
@@ -2,12 +2,15 @@
  * ------------
  * Simple list class for storing a linear collection of elements. It
  * supports operations similar in name to the CS107 DArray -- nth, insert,
- * append, remove, etc.  This class is nothing more than a very thin
- * cover of a STL deque, with some added range-checking. Given not everyone
- * is familiar with the C++ templates, this class provides a more familiar
- * interface.
+ * append, remove, etc. The elements are kept in one contiguous array,
+ * which for a list of up to four elements (as most lists in the tree are)
+ * is inside the List itself. A longer list moves to an array twice the
+ * size, taken from the tree arena like everything else the list has (see
+ * arena.h); the array it leaves behind is only released with the arena.
+ * Indices are range-checked unless built with NDEBUG (see DebugAssert).
  *
- * It can handle elements of any type, the typename for a List includes the
+ * It can handle elements of any type that can be copied byte for byte
+ * (numbers, pointers and the like), the typename for a List includes the
  * element type in angle brackets, e.g.  to store elements of type double,
  * you would use the type name List<double>, to store elements of type
  * Decl *, it woud be List<Decl*> and so on.
@@ -23,13 +26,17 @@
  *       }
  *       return sum;
  *    }
+ *
+ * or equally, with for (int val : *list) as the loop.
  */
 
 #ifndef _H_list
 #define _H_list
 
-#include <deque>
-#include "utility.h"  // for Assert()
+#include <string.h>
+#include <type_traits>
+#include "arena.h"
+#include "utility.h"  // for DebugAssert()
 #include "scope.h"
   
 class Node;
@@ -37,37 +44,67 @@ class Node;
 template<class Element> class List {
 
  private:
-    std::deque<Element> elems;
+    static_assert(std::is_trivially_copyable<Element>::value,
+                  "List elements are moved around with memcpy");
+    static const int InlineCapacity = 4;
+
+    Element *elems;       // inlineElems until the list outgrows them
+    int count, capacity;
+    Element inlineElems[InlineCapacity];
+
+    void Grow()
+        { Element *bigger = (Element *)TreeArena().Alloc(2*capacity*sizeof(Element),
+                                                         Arena::kListStorage);
+          memcpy(bigger, elems, count*sizeof(Element));
+          elems = bigger;
+          capacity *= 2; }
+
+    List(const List&);             // elems may point into the list itself,
+    List &operator=(const List&);  // so lists are not copied
 
  public:
            // Create a new empty list
-    List() {}
+    List() : elems(inlineElems), count(0), capacity(InlineCapacity) {}
+
+    static void *operator new(size_t size) { return TreeArena().Alloc(size, Arena::kList); }
+    static void operator delete(void *) {} // released along with the arena
 
            // Returns count of elements currently in list
     int NumElements() const
-	{ return elems.size(); }
+	{ return count; }
 
           // Returns element at index in list. Indexing is 0-based.
           // Raises an assert if index is out of range.
     Element Nth(int index) const
-	{ Assert(index >= 0 && index < NumElements());
+	{ DebugAssert(index >= 0 && index < count);
 	  return elems[index]; }
 
           // Inserts element at index, shuffling over others
           // Raises assert if index out of range
     void InsertAt(const Element &elem, int index)
-	{ Assert(index >= 0 && index <= NumElements());
-	  elems.insert(elems.begin() + index, elem); }
+	{ DebugAssert(index >= 0 && index <= count);
+	  if (count == capacity) Grow();
+	  memmove(elems + index + 1, elems + index, (count - index)*sizeof(Element));
+	  elems[index] = elem;
+	  count++; }
 
           // Adds element to list end
     void Append(const Element &elem)
-	{ elems.push_back(elem); }
+	{ if (count == capacity) Grow();
+	  elems[count++] = elem; }
 
          // Removes element at index, shuffling down others
          // Raises assert if index out of range
     void RemoveAt(int index)
-	{ Assert(index >= 0 && index < NumElements());
-	  elems.erase(elems.begin() + index); }
+	{ DebugAssert(index >= 0 && index < count);
+	  count--;
+	  memmove(elems + index, elems + index + 1, (count - index)*sizeof(Element)); }
+
+          // For iterating with a range-based for
+    Element *begin() { return elems; }
+    Element *end() { return elems + count; }
+    const Element *begin() const { return elems; }
+    const Element *end() const { return elems + count; }
           
        // These are some specific methods useful for lists of ast nodes
        // They will only work on lists of elements that respond to the
@@ -75,21 +112,12 @@ template<class Element> class List {
        // you can still have Lists of ints, chars*, as long as you 
        // don't try to SetParentAll on that list.
     void SetParentAll(Node *p)
-        { for (int i = 0; i < NumElements(); i++)
-             Nth(i)->SetParent(p); }
+        { for (Element e : *this) e->SetParent(p); }
     void DeclareAll(Scope *s)
-        { for (int i = 0; i < NumElements(); i++)
-             s->Declare(Nth(i)); }
-
-   void CheckAll()
-        { 
-          for (int i = 0; i < NumElements(); i++)
-          {
-            Nth(i)->Check(); 
-          }
-        }
+        { for (Element e : *this) s->Declare(e); }
+    void CheckAll()
+        { for (Element e : *this) e->Check(); }
 
 };
 
 #endif
-
@@ -7,25 +7,52 @@
 #include <string.h>
 #include <stdio.h>
 #include "utility.h"
+#include "trace.h"
 #include "errors.h"
 #include "parser.h"
+#include "arena.h"
+#include "server.h"
+#include "batch.h"
+#include "pipeline.h"
 
 
 /* Function: main()
  * ----------------
  * Entry point to the entire program.  We parse the command line and turn
  * on any debugging flags requested by the user when invoking the program.
- * InitScanner() is used to set up the scanner.
- * InitParser() is used to set up the parser. The call to yyparse() will
- * attempt to parse a complete program from the input. 
+ * InitScanner() is used to read the input.
+ * InitParser() is used to set up the parser. RunPasses() then parses a
+ * complete program from the scanner and checks it if there were no syntax
+ * errors, or stops sooner if asked to (see pipeline.h; with --ast-cache,
+ * the program may come from the tree cache instead, see astcache.h). The
+ * errors found are printed together at the end, see ReportError::Flush.
+ * With -d arena, the sizes of the parse tree are printed at the end, with
+ * -d resolve, how often identifier bindings were reused, and with -d types,
+ * how many canonical types there were (see ast_type.h). With --trace,
+ * the events recorded are written out last (see trace.h). The server
+ * and batch modes (see server.h and batch.h) take over from here instead.
  */
 int main(int argc, char *argv[])
 {
     ParseCommandLine(argc, argv);
+    if (ServerMode())
+        return RunServer();
+    if (BatchMode())
+        return RunBatch();
   
-    InitScanner();
+    {
+        PassTimer timer(kReadPass);
+        InitScanner();
+    }
     InitParser();
-    yyparse();
+    Scanner scanner;
+    RunPasses(&scanner, NumJobs(), AstCachePath());
+    ReportError::Flush();
+    PrintPassTimes();
+    WriteTrace();
+    treeArena.PrintStats();
+    Identifier::PrintResolveStats();
+    Type::PrintStats();
     return (ReportError::NumErrors() == 0? 0 : -1);
 }
 
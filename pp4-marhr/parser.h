@@ -28,11 +28,16 @@
 // we are compiling y.tab.c, which we use the YYBISON symbol for. 
 // Managing C headers can be such a mess! 
 
+struct ParseResult;         // what yypush_parse leaves, see parser.y
+
 #ifndef YYBISON                 
 #include "y.tab.h"              
 #endif
 
-int yyparse();              // Defined in the generated y.tab.c file
 void InitParser();          // Defined in parser.y
 
+// Parse the tokens from the scanner, see parser.y
+Program *ParseProgram(Scanner *scanner);
+StmtBlock *ParseStmtBlock(Scanner *scanner, bool *complete);
+
 #endif
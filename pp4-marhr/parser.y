@@ -12,20 +12,44 @@
 
 /* Just like lex, the text within this first region delimited by %{ and %}
  * is assumed to be C/C++ code and will be copied verbatim to the y.tab.c
- * file ahead of the definitions of the yyparse() function. Add other header
+ * file ahead of the definitions of the parser functions. Add other header
  * file inclusions or C++ variable declarations/prototypes that are needed
  * by your code here.
  */
-#include "scanner.h" // for yylex
+#include "scanner.h" // for Scanner
 #include "parser.h"
 #include "errors.h"
+#include "trace.h"
 #include <iostream>
 using namespace std;
 
-void yyerror(char *msg); // standard error-handling routine
+/* The parser is pure, it keeps no state in globals, so that any number
+ * of threads can parse at once. What a parse produces is left in the
+ * ParseResult passed to it. The parser can also be asked for just a
+ * statement block (see ParseStmtBlock). It then gets a made-up
+ * T_BlockOnly token before the real ones, which steers it to the Input
+ * rule for a lone block.
+ */
+struct ParseResult {
+    Program *program;
+    StmtBlock *block;
+};
+
+static void yyerror(yyltype *loc, ParseResult *, const char *msg)
+{
+    yyerror(loc, msg);  // see errors.cc
+}
 
 %}
 
+/* The parser is pushed one token at a time (see Parse below) instead of
+ * calling yylex, and hands on the location of the lookahead to yyerror.
+ */
+%define api.pure full
+%define api.push-pull push
+%locations
+%parse-param {ParseResult *result}
+
 /* The section before the first %% is the Definitions section of the yacc
  * input file. Here is where you declare tokens and types, add precedence
  * and associativity options, and so on.
@@ -45,7 +69,7 @@ void yyerror(char *msg); // standard error-handling routine
     bool boolConstant;
     char *stringConstant;
     double doubleConstant;
-    char identifier[MaxIdentLen+1]; // +1 for terminating null
+    Symbol *identifier; // interned by the scanner
     
     // ast_decl
     Decl *decl;
@@ -113,6 +137,7 @@ void yyerror(char *msg); // standard error-handling routine
 %token   T_And T_Or T_Null T_Extends T_This T_Interface T_Implements
 %token   T_While T_For T_If T_Else T_Return T_Break T_Switch T_Case T_Default
 %token   T_New T_NewArray T_Print T_ReadInteger T_ReadLine
+%token   T_BlockOnly
 
 %token   <identifier> T_Identifier
 %token   <stringConstant> T_StringConstant 
@@ -203,16 +228,19 @@ void yyerror(char *msg); // standard error-handling routine
  * %% markers which delimit the Rules section.
    
  */
+Input             :   Program
+                  |   T_BlockOnly StmtBlock     { result->block = $2; }
+                  ;
+
 Program           :   DeclList            { 
                                             // @1; 
                                             /* pp2: The @1 is needed to convince 
                                              * yacc to set up yylloc. You can remove 
                                              * it once you have other uses of @n*/
-                                            Program *program = new Program($1);
+                                            result->program = new Program($1);
                                             // if no errors, advance to next phase
                                             // if (ReportError::NumErrors() == 0) 
                                                 // program->Print(0);
-                                            program->Check();
                                           }
                   ;
 
@@ -291,10 +319,10 @@ Prototype         :   Type T_Identifier '(' Formals ')' ';'    { $$ = new FnDecl
                   |   T_Void T_Identifier '(' Formals ')' ';'  { $$ = new FnDecl(new Identifier(@2,$2), Type::voidType, $4);  }
                   ;
 
-StmtBlock         :   '{' VariableDeclList StmtList '}'  { $$ = new StmtBlock($2, $3); }
-                  |   '{' StmtList '}'                   { $$ = new StmtBlock(new List<VarDecl*>, $2); }
-                  |   '{' VariableDeclList '}'           { $$ = new StmtBlock($2, new List<Stmt*>); }
-                  |   '{''}'                             { $$ = new StmtBlock(new List<VarDecl*>, new List<Stmt*>); }
+StmtBlock         :   '{' VariableDeclList StmtList '}'  { $$ = new StmtBlock(Join(@1, @4), $2, $3); }
+                  |   '{' StmtList '}'                   { $$ = new StmtBlock(Join(@1, @3), new List<VarDecl*>, $2); }
+                  |   '{' VariableDeclList '}'           { $$ = new StmtBlock(Join(@1, @3), $2, new List<Stmt*>); }
+                  |   '{''}'                             { $$ = new StmtBlock(Join(@1, @2), new List<VarDecl*>, new List<Stmt*>); }
                   ;
 
 VariableDeclList  :   VariableDeclList VariableDecl { ($$ = $1)->Append($2); }
@@ -421,7 +449,7 @@ Constant          :   T_IntConstant                    { $$ = new IntConstant(@1
 
 /* Function: InitParser
  * --------------------
- * This function will be called before any calls to yyparse().  It is designed
+ * This function will be called before any parsing.  It is designed
  * to give you an opportunity to do anything that must be done to initialize
  * the parser (set global variables, configure starting state, etc.). One
  * thing it already does for you is assign the value of the global variable
@@ -434,6 +462,60 @@ Constant          :   T_IntConstant                    { $$ = new IntConstant(@1
  */
 void InitParser()
 {
-   PrintDebug("parser", "Initializing parser");
+   PrintDebug(kTraceParser, "Initializing parser");
    yydebug = false;
-}
\ No newline at end of file
+}
+
+/* Function: Parse
+ * ---------------
+ * Pushes the tokens from the scanner into a new parser, after the token
+ * first if that is not 0, until the parser accepts them or gives up.
+ * Returns whether it accepted them, and leaves the last token it was
+ * given in last.
+ */
+static bool Parse(Scanner *scanner, int first, ParseResult *result, int *last)
+{
+   yypstate *ps = yypstate_new();
+   if (!ps) Failure("Out of memory!");
+   YYSTYPE value = YYSTYPE();
+   yyltype loc = yyltype();
+   int token = first, status = YYPUSH_MORE;
+   if (first)
+      status = yypush_parse(ps, first, &value, &loc, result);
+   while (status == YYPUSH_MORE) {
+      token = scanner->NextToken(&value, &loc);
+      status = yypush_parse(ps, token, &value, &loc, result);
+   }
+   yypstate_delete(ps);
+   *last = token;
+   return status == 0;
+}
+
+/* Function: ParseProgram
+ * ----------------------
+ * Parses what the scanner has left as a whole program and returns the
+ * Program, NULL if there was a syntax error.
+ */
+Program *ParseProgram(Scanner *scanner)
+{
+   ParseResult result = { NULL, NULL };
+   int last;
+   return Parse(scanner, 0, &result, &last) ? result.program : NULL;
+}
+
+
+/* Function: ParseStmtBlock
+ * ------------------------
+ * Parses what the scanner has left as a single statement block and
+ * returns it, NULL if there was a syntax error. In that case complete
+ * tells whether the error was only found at or past the end of the block
+ * (the input ran out inside it, or more followed it).
+ */
+StmtBlock *ParseStmtBlock(Scanner *scanner, bool *complete)
+{
+   ParseResult result = { NULL, NULL };
+   int last;
+   bool ok = Parse(scanner, T_BlockOnly, &result, &last);
+   *complete = result.block != NULL || last == 0;
+   return ok ? result.block : NULL;
+}
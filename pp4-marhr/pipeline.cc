@@ -0,0 +1,140 @@
+/* File: pipeline.cc
+ * -----------------
+ * Implementation of the passes and their timing.
+ */
+
+#include "pipeline.h"
+#include <string.h>
+#include <mutex>
+#include "parser.h"
+#include "scanner.h"
+#include "astcache.h"
+#include "arena.h"
+#include "utility.h"
+#include "trace.h"
+using namespace std;
+
+static const char *passNames[kNumPasses] = {
+    "read", "lex", "parse", "declare", "check"
+};
+
+struct PassTotals {
+    bool ran;
+    double seconds;
+    size_t allocs, bytes, nodes;
+};
+
+static PassTotals totals[kNumPasses];
+static mutex totalsLock;
+
+Pass PassNamed(const char *name)
+{
+    int p = 0;
+    while (p < kNumPasses && strcmp(passNames[p], name) != 0)
+        p++;
+    return (Pass)p;
+}
+
+
+static void CountAllocs(size_t *allocs, size_t *bytes, size_t *nodes)
+{
+    Arena &arena = TreeArena();
+    *allocs = *bytes = 0;
+    for (int k = 0; k < Arena::kNumKinds; k++) {
+        *allocs += arena.Count((Arena::kind)k);
+        *bytes += arena.Bytes((Arena::kind)k);
+    }
+    *nodes = arena.Count(Arena::kNode);
+}
+
+PassTimer::PassTimer(Pass p) : pass(p)
+{
+    TraceEvent(kTracePasses, 'B', passNames[pass], 0, 0);
+    if (!TimePasses()) return;
+    CountAllocs(&allocs, &bytes, &nodes);
+    start = chrono::steady_clock::now();
+}
+
+PassTimer::~PassTimer()
+{
+    TraceEvent(kTracePasses, 'E', passNames[pass], 0, 0);
+    if (!TimePasses()) return;
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    size_t a, b, n;
+    CountAllocs(&a, &b, &n);
+    lock_guard<mutex> hold(totalsLock);
+    PassTotals &t = totals[pass];
+    t.ran = true;
+    t.seconds += elapsed.count();
+    t.allocs += a - allocs;
+    t.bytes += b - bytes;
+    t.nodes += n - nodes;
+}
+
+
+/* Function: Lex
+ * -------------
+ * The lex pass, when it is the last one: takes every token from the
+ * scanner and drops it.
+ */
+static void Lex(Scanner *scanner)
+{
+    YYSTYPE value = YYSTYPE();
+    yyltype loc = yyltype();
+    int numTokens = 0;
+    while (scanner->NextToken(&value, &loc))
+        numTokens++;
+    PrintDebug(kTraceLex, "%d tokens", numTokens);
+}
+
+void RunPasses(Scanner *scanner, int numThreads, const char *cachePath)
+{
+    Pass last = LastPass();
+    if (last == kReadPass) return;
+    if (last == kLexPass) {
+        PassTimer timer(kLexPass);
+        Lex(scanner);
+        return;
+    }
+
+    Program *program;
+    {
+        PassTimer timer(kParsePass);
+        program = cachePath ? AstCache::Parse(cachePath, scanner)
+                            : ParseProgram(scanner);
+    }
+    if (!program || last == kParsePass) return;
+
+    {
+        PassTimer timer(kDeclarePass);
+        program->Declare();
+    }
+    if (last == kDeclarePass) {
+        program->OutputErrors();
+        return;
+    }
+
+    PassTimer timer(kCheckPass);
+    program->CheckBodies(numThreads);
+}
+
+
+void PrintPassTimes()
+{
+    if (!TimePasses()) return;
+    PassTotals sum = PassTotals();
+    fprintf(stderr, "%-10s %10s %12s %12s %10s\n",
+            "pass", "wall ms", "allocations", "bytes", "nodes");
+    for (int p = 0; p < kNumPasses; p++) {
+        const PassTotals &t = totals[p];
+        if (!t.ran) continue;
+        fprintf(stderr, "%-10s %10.2f %12lu %12lu %10lu\n", passNames[p], t.seconds * 1000,
+                (unsigned long)t.allocs, (unsigned long)t.bytes, (unsigned long)t.nodes);
+        sum.seconds += t.seconds;
+        sum.allocs += t.allocs;
+        sum.bytes += t.bytes;
+        sum.nodes += t.nodes;
+    }
+    fprintf(stderr, "%-10s %10.2f %12lu %12lu %10lu\n", "total", sum.seconds * 1000,
+            (unsigned long)sum.allocs, (unsigned long)sum.bytes, (unsigned long)sum.nodes);
+}
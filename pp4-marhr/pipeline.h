@@ -0,0 +1,92 @@
+/* File: pipeline.h
+ * ----------------
+ * A program is compiled in passes, each done with before the next one
+ * starts:
+ *
+ *    read      the source is read into memory (see source.h)
+ *    parse     the tree is built, the scanner handing the parser each
+ *              token as it asks for it (see parser.h), or it is taken
+ *              from the tree cache (see astcache.h)
+ *    declare   the scopes are built, the global one and those of the
+ *              classes and interfaces, and what those extend and
+ *              implement is checked (see Program::Declare)
+ *    check     the function bodies are checked, each identifier bound
+ *              to its declaration as it is met and the type of each
+ *              expression worked out
+ *
+ * With --stop-after <pass>, compiling ends after the given pass, and
+ * only the errors found up to then are output. -fsyntax-only is the
+ * same as --stop-after parse. The pass given can also be lex, which
+ * runs the scanner over the source alone to report its errors (in the
+ * other passes the scanner only runs inside parse).
+ *
+ * With --time-passes, a table is printed on stderr at the end with the
+ * wall time each pass took, and how many allocations it made from the
+ * tree arena, their size and how many of them were nodes. In batch mode
+ * these are the totals over all the files. With --trace, each pass is
+ * also recorded as a span on the timeline of its thread (see trace.h).
+ */
+
+#ifndef _H_pipeline
+#define _H_pipeline
+
+#include <stdio.h>
+#include <chrono>
+
+class Scanner;
+
+typedef enum { kReadPass, kLexPass, kParsePass, kDeclarePass, kCheckPass,
+               kNumPasses } Pass;
+
+// Returns the pass with the given name, kNumPasses if there is none
+Pass PassNamed(const char *name);
+
+
+/* Functions: LastPass(), TimePasses()
+ * -----------------------------------
+ * LastPass returns the pass to stop after, as given with --stop-after or
+ * -fsyntax-only, the check pass if neither was given. TimePasses returns
+ * whether --time-passes was given. Both are set by ParseCommandLine (see
+ * utility.h).
+ */
+Pass LastPass();
+bool TimePasses();
+
+
+/* Class: PassTimer
+ * ----------------
+ * Measures a pass, from the timer being made until it is destroyed, for
+ * --time-passes. The allocations are counted in the calling thread's
+ * tree arena.
+ */
+class PassTimer
+{
+  public:
+    PassTimer(Pass p);
+    ~PassTimer();
+
+  private:
+    Pass pass;
+    std::chrono::steady_clock::time_point start;
+    size_t allocs, bytes, nodes;
+};
+
+
+/* Function: RunPasses
+ * -------------------
+ * Runs the passes after read over the calling thread's source, up to the
+ * last one asked for on the command line. The parse pass uses the tree
+ * cache at cachePath if it is not NULL, and the check pass numThreads
+ * threads. The errors are reported as usual, it is up to the caller to
+ * flush them.
+ */
+void RunPasses(Scanner *scanner, int numThreads, const char *cachePath);
+
+
+/* Function: PrintPassTimes
+ * ------------------------
+ * Prints the --time-passes table, if that was given.
+ */
+void PrintPassTimes();
+
+#endif
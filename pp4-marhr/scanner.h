@@ -9,17 +9,49 @@
 #define _H_scanner
 
 #include <stdio.h>
+#include "location.h"
 
 #define MaxIdentLen 31    // Maximum length for identifiers
+#define TAB_SIZE 8        // A tab advances the column to the next stop
 
-extern char *yytext;      // Text of lexeme just scanned
+union YYSTYPE;            // Defined in the generated y.tab.h file
 
 
-int yylex();              // Defined in the generated lex.yy.c file
-void yyrestart(FILE *fp); // ditto
+void InitScanner();       // Defined in scanner.l user subroutines
 
 
-void InitScanner();                 // Defined in scanner.l user subroutines
-const char *GetLineNumbered(int n); // ditto
+/* Class: Scanner
+ * --------------
+ * One scan of the calling thread's source buffer (see source.h), which
+ * hands the parser its tokens. All of the state of the scan is in the
+ * Scanner, so each compilation can have its own, and any number of
+ * threads can scan at once. The scanner built (the flex one in scanner.l
+ * or the one in fastscanner.cc, see the Makefile) defines what State is.
+ */
+class Scanner
+{
+  public:
+    struct State;
+
+          // Starts at the beginning of the source, on line 1 column 1
+    Scanner();
+    ~Scanner();
+
+          // Scans the source again from offset up to end, the first
+          // character being at the given line and column. This is how
+          // the compiler server reparses a part of the source (see
+          // server.h).
+    void Restart(size_t offset, size_t end, int line, int column);
+
+          // Returns the next token, 0 at the end, with its value and
+          // location filled in
+    int NextToken(YYSTYPE *value, yyltype *loc);
+
+  private:
+    State *state;
+
+    Scanner(const Scanner&);
+    Scanner &operator=(const Scanner&);
+};
  
 #endif
@@ -2,28 +2,88 @@
  * --------------     
  * Each Scope object tracks its own hashtable and 
  * may have additional information about the particulars for this 
- * scope (class, fn, global, etc.)
+ * scope (class, fn, global, etc.) It also links to the scope that
+ * encloses it (NULL for the global scope), the chain a lookup walks.
  */
 
 #include "scope.h"
 #include "ast_decl.h"
 #include "list.h"
+#include "trace.h"
+#include <stdint.h>
+#include <mutex>
 
 
-Scope::Scope()
+// Marks a name the inherited cache knows is not inherited
+static char notInherited;
+#define NotInherited ((Decl *)&notInherited)
+
+Scope::Scope(Scope *e)
 {
     table = new Hashtable<Decl*>;
+    enclosing = e;
+    inheritedCache = NULL;
 }
 
 
 /* Method: Lookup
  * --------------
- * Looks for an identifier in this scope only. Returns NULL if
- * not found.
+ * Looks for an identifier in this scope only (along with what it
+ * inherits). Returns NULL if not found.
  */
 Decl *Scope::Lookup(Identifier *id)       
 {
-    return table->Lookup(id->GetName());
+    Decl *d = table->Lookup(id->GetSymbol());
+    if (d || inherited.empty())
+        return d;
+    return LookupInherited(id->GetSymbol());
+}
+
+// The inherited caches are guarded, when they need to be, by one of a few
+// locks picked by the scope's address
+static bool locking = false;
+static const int NumCacheLocks = 16;
+static std::mutex cacheLocks[NumCacheLocks];
+
+void Scope::SetLocking(bool on)
+{
+    locking = on;
+}
+
+Decl *Scope::LookupInherited(Symbol *name)
+{
+    std::unique_lock<std::mutex> hold;
+    if (locking)
+        hold = std::unique_lock<std::mutex>(cacheLocks[((uintptr_t)this / 64) % NumCacheLocks]);
+    if (!inheritedCache)
+        inheritedCache = new Hashtable<Decl*>;
+    Decl *d = inheritedCache->Lookup(name);
+    if (d)
+        return d == NotInherited ? NULL : d;
+    d = SearchLayers(name);
+    inheritedCache->Enter(name, d ? d : NotInherited);
+    return d;
+}
+
+
+/* Method: SearchLayers
+ * --------------------
+ * Searches the inherited layers for name, the last added first, and
+ * their layers in turn. This only reads the layers' own tables, which
+ * are complete by then, never their caches, so classes checked on
+ * different threads can search a shared superclass at the same time.
+ */
+Decl *Scope::SearchLayers(Symbol *name)
+{
+    for (int i = inherited.size() - 1; i >= 0; i--) {
+        Scope *layer = inherited[i];
+        Decl *d = layer->table->Lookup(name);
+        if (!d)
+            d = layer->SearchLayers(name);
+        if (d)
+            return d;
+    }
+    return NULL;
 }
 
 
@@ -35,20 +95,42 @@ Decl *Scope::Lookup(Identifier *id)
  */
 bool Scope::Declare(Decl *decl)
 {
-  Decl *prev = table->Lookup(decl->GetName());
-  PrintDebug("scope", "Line %d declaring %s (prev? %p)\n", decl->GetLocation()->first_line, decl->GetName(), prev);
+  Decl *prev = table->Lookup(decl->GetSymbol());
+  if (!prev && !inherited.empty())
+      prev = LookupInherited(decl->GetSymbol());
+  PrintDebug(kTraceScope, "Line %d declaring %s (prev? %p)\n", decl->GetLocation()->first_line, decl->GetName(), prev);
+  TraceEvent(kTraceScope, 'i', decl->GetName(), decl->GetLocation()->first_line, Depth());
   if (prev && decl->ConflictsWithPrevious(prev)) // throw away second, keep first
       return false;
-  table->Enter(decl->GetName(), decl);
+  table->Enter(decl->GetSymbol(), decl);
   return true;
 }
 
-void Scope::CopyFromScope(Scope *other, ClassDecl *addTo)
+/* Method: Depth
+ * -------------
+ * Returns how many scopes enclose this one, 0 for the global scope.
+ */
+int Scope::Depth()
+{
+    int depth = 0;
+    for (Scope *s = enclosing; s; s = s->enclosing)
+        depth++;
+    return depth;
+}
+
+/* Method: Inherit
+ * ---------------
+ * Adds the members of other (and all it inherits) to those visible in
+ * this scope without copying them. Layers added later take precedence
+ * over earlier ones. A class scope may be searched while its layers are
+ * still being added, so anything cached so far is dropped.
+ */
+void Scope::Inherit(Scope *other)
 {
-    Iterator<Decl*> iter = other->table->GetIterator();
-    Decl *decl;
-    while ((decl = iter.GetNextValue()) != NULL) {
-        table->Enter(decl->GetName(), decl);
+    inherited.push_back(other);
+    if (inheritedCache) {
+        delete inheritedCache;
+        inheritedCache = NULL;
     }
 }
 
@@ -2,12 +2,25 @@
  * -------------
  * The Scope class will be used to manage scopes, sort of
  * table used to map identifier names to Declaration objects.
+ *
+ * A class scope holds only the members the class itself declares. What
+ * it inherits is found through the scopes of its superclass and the
+ * interfaces it implements, added as layers with Inherit. A name missing
+ * from a class's own table is searched in those layers, the last layer
+ * added first, and the answer (found or not) is remembered in the scope
+ * it was asked of, so the next lookup of that name is a single probe no
+ * matter how deep the hierarchy is.
+ *
+ * Scopes and their tables are allocated from the tree arena (see arena.h)
+ * and go away with the tree they were built for.
  */
 
 #ifndef _H_scope
 #define _H_scope
 
+#include <vector>
 #include "hashtable.h"
+#include "arena.h"
 
 class Decl;
 class Identifier;
@@ -16,13 +29,29 @@ class ClassDecl;
 class Scope { 
   protected:
     Hashtable<Decl*> *table;
+    Scope *enclosing;
+    std::vector<Scope*, ArenaAllocator<Scope*> > inherited;
+    Hashtable<Decl*> *inheritedCache;  // names already searched for in layers
+
+    Decl *LookupInherited(Symbol *name);
+    Decl *SearchLayers(Symbol *name);
 
   public:
-    Scope();
+    Scope(Scope *enclosing = NULL);
+
+    static void *operator new(size_t size) { return TreeArena().Alloc(size); }
+    static void operator delete(void *) {} // released along with the arena
+
+    Scope *GetEnclosing() { return enclosing; }
+    int Depth();
 
     Decl *Lookup(Identifier *id);
     bool Declare(Decl *dec);
-    void CopyFromScope(Scope *other, ClassDecl *cd);
+    void Inherit(Scope *other);
+
+          // Turns on locking around the inherited caches, needed while
+          // members of one class are checked on different threads
+    static void SetLocking(bool on);
 };
 
 
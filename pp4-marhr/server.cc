@@ -0,0 +1,293 @@
+/* File: server.cc
+ * ---------------
+ * Implementation of the compiler server.
+ *
+ * The checking of the program is split into units whose errors are kept
+ * apart: declaring the top-level names, then for each top-level decl its
+ * PrepareCheck and its CheckBody, the latter taken member by member for
+ * a class. This is the order Program::Check goes in, so putting the
+ * errors of all the units together gives the same output. When a body is
+ * reparsed, only the unit checking its function is redone.
+ */
+
+#include "server.h"
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "errors.h"
+#include "parser.h"
+#include "scanner.h"
+#include "source.h"
+#include "utility.h"
+using namespace std;
+
+typedef vector<ReportError::Message> Messages;
+
+struct Unit {
+    Decl *decl;           // NULL for declaring the top-level names
+    bool prepare;         // the PrepareCheck of decl rather than its check
+    FnDecl *fn;           // decl, when checking a function with a body
+    Messages errors;
+    Messages parseErrors; // from reparsing the body of decl, if it was
+};
+
+/* A function body in the text: the FnDecl it belongs to, the unit that
+ * checks that function, and where its braces are.
+ */
+struct Body {
+    FnDecl *fn;
+    int unit;
+    size_t open, close;   // offsets of the { and the }
+    int openLine, openColumn;
+};
+
+static string source;
+static Program *program;       // NULL if the text did not parse
+static Messages parseErrors;   // from the last time all of it was parsed
+static vector<Unit> units;
+
+// A body that was last reparsed with a syntax error inside it. The tree
+// still has its last good version, the text has the broken one.
+static bool broken;
+static Body brokenBody;
+static Messages brokenErrors;
+
+
+static void CheckUnit(Decl *decl, bool prepare)
+{
+    FnDecl *fn = prepare ? NULL : dyn_cast<FnDecl>(decl);
+    Unit unit = { decl, prepare, fn && fn->GetBody() ? fn : NULL };
+    units.push_back(unit);
+    ReportError::CaptureOutput(&units.back().errors);
+    if (!decl)
+        program->GetEnclosingScope();
+    else if (prepare)
+        decl->PrepareCheck();
+    else
+        decl->Check();
+    ReportError::CaptureOutput(NULL);
+}
+
+
+/* Function: CompileAll
+ * --------------------
+ * Parses and checks the whole text from scratch, unit by unit. The tree
+ * from before, along with any bodies put into it since, is released
+ * first.
+ */
+static void CompileAll()
+{
+    Node::ForgetShifts();
+    units.clear();
+    parseErrors.clear();
+    broken = false;
+    program = NULL;
+    TreeArena().Release();
+    SetSource(source.data(), source.size());
+    Scanner scanner;
+    ReportError::CaptureOutput(&parseErrors);
+    program = ParseProgram(&scanner);
+    ReportError::CaptureOutput(NULL);
+    if (!program) return;
+
+    CheckUnit(NULL, false);
+    List<Decl*> *decls = program->GetDecls();
+    for (int i = 0; i < decls->NumElements(); i++) {
+        Decl *d = decls->Nth(i);
+        CheckUnit(d, true);
+        ClassDecl *c = dyn_cast<ClassDecl>(d);
+        if (!c) {
+            CheckUnit(d, false);
+            continue;
+        }
+        List<Decl*> *members = c->GetMembers();
+        for (int j = 0; j < members->NumElements(); j++)
+            CheckUnit(members->Nth(j), false);
+    }
+}
+
+
+/* Function: FindBody
+ * ------------------
+ * Looks for the function body that has the text from start up to end
+ * strictly inside its braces. The braces are located from the line and
+ * columns of the body, and if the characters found there are not braces
+ * after all (which happens when a tab inside a string or comment on the
+ * same line makes the columns count differently), it is not used.
+ */
+static bool FindBody(size_t start, size_t end, Body *b)
+{
+    int startLine = GetLineAt(start), endLine = GetLineAt(end);
+    for (size_t i = 0; i < units.size(); i++) {
+        FnDecl *fn = units[i].fn;
+        if (!fn) continue;
+        yyltype *loc = fn->GetBody()->GetLocation();
+        if (loc->first_line > startLine || loc->last_line < endLine) continue;
+        b->fn = fn;
+        b->unit = i;
+        b->open = GetOffsetOf(loc->first_line, loc->first_column);
+        b->close = GetOffsetOf(loc->last_line, loc->last_column);
+        b->openLine = loc->first_line;
+        b->openColumn = loc->first_column;
+        return source[b->open] == '{' && source[b->close] == '}' &&
+               b->open < start && end <= b->close;
+    }
+    return false;
+}
+
+
+static void ShiftErrors(Messages &list, int afterLine, int delta)
+{
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i].line != INT_MAX && list[i].line > afterLine)
+            list[i].line += delta;
+        if (list[i].refLine > afterLine)
+            list[i].refLine += delta;
+    }
+}
+
+
+/* Function: Edit
+ * --------------
+ * Applies an edit to the text and brings the tree and errors up to date,
+ * incrementally if the edit is inside a function body. Returns whether
+ * it was done incrementally.
+ *
+ * Nothing but blanks may follow the closing brace on the last line of
+ * the edit, else the columns of whatever follows would change too. The
+ * line the edit ends on, and anything after it, moves by as many lines
+ * as the edit adds or removes.
+ */
+static bool Edit(size_t start, size_t end, const string &text)
+{
+    Body b;
+    bool found = broken ? brokenBody.open < start && end <= brokenBody.close
+                        : program && parseErrors.empty() && FindBody(start, end, &b);
+    if (broken) b = brokenBody;
+    int endLine = GetLineAt(end);
+    if (found && GetLineAt(b.close) == endLine) {
+        size_t after = b.close + 1;
+        while (after < source.size() && (source[after] == ' ' || source[after] == '\t'))
+            after++;
+        found = after == source.size() || source[after] == '\n';
+    }
+
+    int delta = 0;
+    for (size_t i = 0; i < text.size(); i++) delta += text[i] == '\n';
+    for (size_t i = start; i < end; i++) delta -= source[i] == '\n';
+    source.replace(start, end - start, text);
+    if (!found) {
+        CompileAll();
+        return false;
+    }
+    b.close += text.size() - (end - start);
+    SetSource(source.data(), source.size());
+    if (delta) {
+        Node::ShiftLines(endLine, delta);
+        ShiftErrors(parseErrors, endLine, delta);
+        for (size_t i = 0; i < units.size(); i++) {
+            ShiftErrors(units[i].errors, endLine, delta);
+            ShiftErrors(units[i].parseErrors, endLine, delta);
+        }
+    }
+
+    Messages errors;
+    bool complete;
+    Scanner scanner;
+    scanner.Restart(b.open, b.close + 1, b.openLine, b.openColumn);
+    ReportError::CaptureOutput(&errors);
+    StmtBlock *block = ParseStmtBlock(&scanner, &complete);
+    ReportError::CaptureOutput(NULL);
+    if (!block && complete) {   // the braces do not match up any more
+        CompileAll();
+        return false;
+    }
+    if (!block) {
+        broken = true;
+        brokenBody = b;
+        brokenErrors = errors;
+        return true;
+    }
+
+    broken = false;
+    b.fn->SetFunctionBody(block);
+    Unit &unit = units[b.unit];
+    unit.parseErrors = errors;
+    unit.errors.clear();
+    ReportError::CaptureOutput(&unit.errors);
+    b.fn->Check();
+    ReportError::CaptureOutput(NULL);
+    return true;
+}
+
+
+/* Function: CollectErrors
+ * -----------------------
+ * Returns the error output for the text as it stands. When parsing stops
+ * at a syntax error, only the errors the scanner found before that point
+ * are output.
+ */
+static void Add(vector<const ReportError::Message*> &all, const Messages &list)
+{
+    for (size_t i = 0; i < list.size(); i++)
+        all.push_back(&list[i]);
+}
+
+static string CollectErrors()
+{
+    vector<const ReportError::Message*> all;
+    Add(all, parseErrors);
+    size_t n = broken ? brokenBody.unit : units.size();
+    for (size_t i = 0; i < n; i++)
+        Add(all, units[i].parseErrors);
+    if (broken)
+        Add(all, brokenErrors);
+    else
+        for (size_t i = 0; i < units.size(); i++)
+            Add(all, units[i].errors);
+    return ReportError::FormatAll(all);
+}
+
+static void Reply(bool incremental)
+{
+    string errors = CollectErrors();
+    printf("errors %lu %s\n", (unsigned long)errors.size(), incremental ? "incremental" : "full");
+    fwrite(errors.data(), 1, errors.size(), stdout);
+    fflush(stdout);
+}
+
+static bool ReadText(size_t n, string *text)
+{
+    text->resize(n);
+    return n == 0 || fread(&(*text)[0], 1, n, stdin) == n;
+}
+
+
+int RunServer()
+{
+    InitParser();
+    UseOwnTreeArena();
+    UseOwnSource();
+    char line[256];
+    string text;
+    while (fgets(line, sizeof(line), stdin)) {
+        unsigned long start, end, n;
+        if (sscanf(line, "open %lu", &n) == 1 && ReadText(n, &text)) {
+            source = text;
+            CompileAll();
+            Reply(false);
+        } else if (sscanf(line, "edit %lu %lu %lu", &start, &end, &n) == 3 &&
+                   start <= end && end <= source.size() && ReadText(n, &text)) {
+            Reply(Edit(start, end, text));
+        } else if (strcmp(line, "quit\n") == 0) {
+            break;
+        } else {
+            printf("bad command\n");
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
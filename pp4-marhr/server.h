@@ -0,0 +1,38 @@
+/* File: server.h
+ * --------------
+ * The compiler server (dcc --server) keeps a program loaded between
+ * requests, for an editor that wants the errors again after each change
+ * to the text. It reads commands on stdin and answers each on stdout:
+ *
+ *    open <n>                  the n bytes that follow are the new text
+ *    edit <start> <end> <n>    the n bytes that follow replace the text
+ *                              from offset start up to offset end
+ *    quit
+ *
+ * Open and edit are answered with a line "errors <n> <how>" followed by
+ * n bytes of error output, exactly what dcc prints for the text as it
+ * now stands. How is "full" if the whole text was compiled again and
+ * "incremental" if not. Anything else gets the line "bad command".
+ *
+ * An edit inside the braces of a function or method body is handled
+ * incrementally: the body alone is reparsed and put in place of the old
+ * one in the tree, and that function alone is checked again. The rest of
+ * the tree, its scopes and the errors found in it are kept, and moved
+ * down or up if the edit added or removed lines. Any other edit, or one
+ * after which the braces of the body no longer match up, compiles the
+ * whole text again. The server builds its trees in an arena of its own,
+ * which each full compile releases before parsing, so a body replaced is
+ * kept until then and a whole tree only until the next one is built.
+ */
+
+#ifndef _H_server
+#define _H_server
+
+/* Function: RunServer
+ * -------------------
+ * Serves commands until quit or the end of stdin, then returns the exit
+ * status.
+ */
+int RunServer();
+
+#endif
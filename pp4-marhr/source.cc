@@ -0,0 +1,181 @@
+/* File: source.cc
+ * ---------------
+ * Implementation of the source buffer and its line index.
+ */
+
+#include "source.h"
+#include "utility.h"
+#include "scanner.h" // for TAB_SIZE
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* The state of a source. The main thread's is mainSource, which every
+ * other thread shares too unless it calls UseOwnSource. The buffer is
+ * freed by the next ReadSource if it was ReadSource that made it.
+ */
+struct Source {
+    const char *text;
+    size_t size, readPos, readEnd;
+    std::vector<unsigned int> lineStarts;  // offset of line n at index n-1
+    bool mapped, allocated;
+
+    Source() : text(NULL), size(0), readPos(0), readEnd(0),
+               mapped(false), allocated(false) {}
+    ~Source() { FreeBuffer(); }
+    void FreeBuffer();
+};
+
+static Source mainSource;
+static thread_local Source *current = &mainSource;
+
+void Source::FreeBuffer()
+{
+    if (mapped) munmap((void *)text, size);
+    if (allocated) free((void *)text);
+    mapped = allocated = false;
+}
+
+void UseOwnSource()
+{
+    static thread_local Source own;
+    current = &own;
+}
+
+
+/* Function: ReadSource
+ * --------------------
+ * A regular file is mapped rather than read, anything else (a pipe, a
+ * terminal) is read in chunks into a growing buffer.
+ */
+void ReadSource(FILE *fp)
+{
+    Source &s = *current;
+    int fd = fileno(fp);
+    struct stat st;
+    s.FreeBuffer();
+    s.text = NULL;
+    s.size = 0;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            s.text = (const char *)p;
+            s.size = st.st_size;
+            s.mapped = true;
+        }
+    }
+    if (!s.text) {
+        size_t capacity = 64*1024;
+        char *buf = (char *)malloc(capacity);
+        ssize_t n;
+        while (buf && (n = read(fd, buf + s.size, capacity - s.size)) > 0) {
+            s.size += n;
+            if (s.size == capacity)
+                buf = (char *)realloc(buf, capacity *= 2);
+        }
+        if (!buf) Failure("Out of memory!");
+        s.text = buf;
+        s.allocated = true;
+    }
+    if (s.size > 0xffffffffu) Failure("Input too large!");
+    s.readPos = 0;
+    s.readEnd = s.size;
+    s.lineStarts.clear();
+    s.lineStarts.push_back(0);
+}
+
+void SetSource(const char *t, size_t length)
+{
+    Source &s = *current;
+    if (length > 0xffffffffu) Failure("Input too large!");
+    if (t != s.text) s.FreeBuffer();
+    s.text = t;
+    s.size = length;
+    s.readPos = 0;
+    s.readEnd = s.size;
+    s.lineStarts.clear();
+    s.lineStarts.push_back(0);
+    for (const char *p = t; (p = (const char *)memchr(p, '\n', t + length - p)); )
+        s.lineStarts.push_back(++p - t);
+}
+
+void SetSourceRange(size_t start, size_t end)
+{
+    Source &s = *current;
+    Assert(start <= end && end <= s.size);
+    s.readPos = start;
+    s.readEnd = end;
+}
+
+int ReadSourceChars(char *buf, int max)
+{
+    Source &s = *current;
+    size_t n = s.readEnd - s.readPos;
+    if (n > (size_t)max) n = max;
+    memcpy(buf, s.text + s.readPos, n);
+    s.readPos += n;
+    return n;
+}
+
+const char *GetSourceText(size_t *length)
+{
+    *length = current->size;
+    return current->text;
+}
+
+// A line already in the index (from SetSource, or an earlier scan) is
+// not added again.
+void AddLineStart(size_t offset)
+{
+    std::vector<unsigned int> &lineStarts = current->lineStarts;
+    if (offset > lineStarts.back())
+        lineStarts.push_back(offset);
+}
+
+
+/* Function: GetLineNumbered
+ * -------------------------
+ * The line runs from its recorded start to the next newline (the next
+ * line may not have been recorded yet if the scanner is still on it).
+ * A line that would start at the very end of the input does not exist.
+ */
+SourceLine GetLineNumbered(int num)
+{
+    const Source &s = *current;
+    SourceLine line = { NULL, 0 };
+    if (num <= 0 || num > (int)s.lineStarts.size() || s.lineStarts[num-1] >= s.size)
+        return line;
+    line.text = s.text + s.lineStarts[num-1];
+    const char *end = (const char *)memchr(line.text, '\n', s.text + s.size - line.text);
+    line.length = (end ? end : s.text + s.size) - line.text;
+    return line;
+}
+
+int GetLineAt(size_t offset)
+{
+    const std::vector<unsigned int> &lineStarts = current->lineStarts;
+    return std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin();
+}
+
+
+/* Function: GetOffsetOf
+ * ---------------------
+ * Walks the line counting columns as the scanner does between tokens,
+ * each character is one column except a tab, which moves on to the next
+ * tab stop.
+ */
+size_t GetOffsetOf(int line, int column)
+{
+    const Source &s = *current;
+    Assert(line > 0 && line <= (int)s.lineStarts.size());
+    size_t offset = s.lineStarts[line-1];
+    for (int col = 1; col < column && offset < s.size && s.text[offset] != '\n'; offset++) {
+        col++;
+        if (s.text[offset] == '\t')
+            col += TAB_SIZE - col%TAB_SIZE + 1;
+    }
+    return offset;
+}
@@ -0,0 +1,110 @@
+/* File: source.h
+ * --------------
+ * The source module holds the text of the program being compiled. The
+ * whole input is read once into a single buffer (mapped straight from
+ * the file when it is a regular file) and the scanner takes its input
+ * from there. As the scanner passes each newline it records where the
+ * next line starts, so the text of any line read so far can be handed
+ * out for error messages as a view into the buffer, without copying.
+ *
+ * There is one source for the whole program, unless a thread asks for
+ * one of its own with UseOwnSource (batch mode compiles a file on each of
+ * its threads, see batch.h). All the functions below then work on the
+ * calling thread's source.
+ */
+
+#ifndef _H_source
+#define _H_source
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* A line of source, not null-terminated. The text is NULL if the line
+ * is not available (not reached yet, or past the end of the input).
+ */
+struct SourceLine {
+    const char *text;
+    int length;
+};
+
+
+/* Function: ReadSource
+ * --------------------
+ * Reads all of fp into the source buffer and resets the line index.
+ * Must be called before the scanner asks for input. The buffer from an
+ * earlier ReadSource is freed.
+ */
+void ReadSource(FILE *fp);
+
+
+/* Function: UseOwnSource
+ * ----------------------
+ * Gives the calling thread a source of its own from now on, freed when
+ * the thread ends.
+ */
+void UseOwnSource();
+
+
+/* Function: SetSource
+ * -------------------
+ * Makes the given text the source, in place of reading it, and indexes
+ * all its lines up front (the compiler server keeps the text in memory
+ * and edits it). The text must stay valid until the source is replaced.
+ * Scanning the text again later, or a part of it, leaves the line index
+ * as it is.
+ */
+void SetSource(const char *text, size_t size);
+
+
+/* Function: SetSourceRange
+ * ------------------------
+ * Makes ReadSourceChars hand out the source from offset start up to end
+ * (ReadSource and SetSource set up for all of it).
+ */
+void SetSourceRange(size_t start, size_t end);
+
+
+/* Function: ReadSourceChars
+ * -------------------------
+ * Copies up to max of the next unread characters of the source into
+ * buf and returns how many were copied, 0 at the end. This is what the
+ * scanner uses as its YY_INPUT.
+ */
+int ReadSourceChars(char *buf, int max);
+
+
+/* Function: GetSourceText
+ * -----------------------
+ * Returns the whole source buffer and stores its length in size. The
+ * text is not null-terminated and must not be modified. A scanner that
+ * works on the buffer in place uses this instead of ReadSourceChars.
+ */
+const char *GetSourceText(size_t *size);
+
+
+/* Function: AddLineStart
+ * ----------------------
+ * Records that a new line starts at the given offset of the source.
+ * The scanner calls this on every newline, line 1 starts at offset 0.
+ */
+void AddLineStart(size_t offset);
+
+
+/* Function: GetLineNumbered
+ * -------------------------
+ * Returns a view of line number n (not including the newline).
+ */
+SourceLine GetLineNumbered(int n);
+
+
+/* Functions: GetLineAt, GetOffsetOf
+ * ---------------------------------
+ * Convert between offsets in the source and the line and column numbers
+ * the scanner gives out (columns count a tab the way the scanner does).
+ * GetOffsetOf returns the offset of the character at the given line and
+ * column, which must both be in the part of the source indexed so far.
+ */
+int GetLineAt(size_t offset);
+size_t GetOffsetOf(int line, int column);
+
+#endif
@@ -0,0 +1,103 @@
+/* File: symbol.cc
+ * ---------------
+ * Implementation of the Symbol intern table, a chained hash table that
+ * doubles in size whenever it holds as many symbols as buckets. Symbols
+ * and their names are placed in an arena of their own, separate from the
+ * parse tree.
+ */
+
+#include "symbol.h"
+#include "arena.h"
+#include "utility.h"
+#include <string.h>
+#include <new>
+#include <mutex>
+
+static Arena symbolArena;
+static Symbol **buckets = NULL;
+static int numBuckets = 0, numSymbols = 0;
+static bool locking = false;
+static std::mutex tableLock;
+
+static const int InitialBuckets = 1024;
+
+
+/* Function: HashName
+ * ------------------
+ * FNV-1a hash over the first length characters of name.
+ */
+static unsigned int HashName(const char *name, int length)
+{
+    unsigned int h = 2166136261u;
+    for (int i = 0; i < length; i++)
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h;
+}
+
+Symbol::Symbol(const char *n, int len, unsigned int h)
+{
+    char *copy = (char *)symbolArena.Alloc(len + 1);
+    memcpy(copy, n, len);
+    copy[len] = '\0';
+    name = copy;
+    length = len;
+    hash = h;
+    id = numSymbols;
+    chain = NULL;
+}
+
+Symbol *Symbol::Intern(const char *name)
+{
+    return Intern(name, strlen(name));
+}
+
+Symbol *Symbol::Intern(const char *name, int length)
+{
+    if (!locking) return Add(name, length);
+    std::lock_guard<std::mutex> hold(tableLock);
+    return Add(name, length);
+}
+
+Symbol *Symbol::Add(const char *name, int length)
+{
+    unsigned int h = HashName(name, length);
+    if (numBuckets) {
+        for (Symbol *s = buckets[h & (numBuckets-1)]; s; s = s->chain)
+            if (s->hash == h && s->length == length && !memcmp(s->name, name, length))
+                return s;
+    }
+
+    if (numSymbols >= numBuckets) {  // grow and rehash before adding
+        int newSize = numBuckets ? 2*numBuckets : InitialBuckets;
+        Symbol **newBuckets = (Symbol **)calloc(newSize, sizeof(Symbol *));
+        if (!newBuckets) Failure("Out of memory!");
+        for (int i = 0; i < numBuckets; i++) {
+            Symbol *s = buckets[i];
+            while (s) {
+                Symbol *next = s->chain;
+                s->chain = newBuckets[s->hash & (newSize-1)];
+                newBuckets[s->hash & (newSize-1)] = s;
+                s = next;
+            }
+        }
+        free(buckets);
+        buckets = newBuckets;
+        numBuckets = newSize;
+    }
+
+    Symbol *s = new(symbolArena.Alloc(sizeof(Symbol))) Symbol(name, length, h);
+    s->chain = buckets[h & (numBuckets-1)];
+    buckets[h & (numBuckets-1)] = s;
+    numSymbols++;
+    return s;
+}
+
+int Symbol::NumSymbols()
+{
+    return numSymbols;
+}
+
+void Symbol::SetLocking(bool on)
+{
+    locking = on;
+}
@@ -0,0 +1,49 @@
+/* File: symbol.h
+ * --------------
+ * The Symbol class represents an interned name. The scanner interns each
+ * identifier as it is read, so there is exactly one Symbol object for
+ * every distinct spelling and two names are the same if and only if
+ * their Symbol pointers are equal. No strcmp needed.
+ *
+ * Each symbol also carries a small integer id, handed out in the order
+ * the names were first interned, and its hash value, which tables keyed
+ * by symbols can use directly. Symbols live for the whole run of the
+ * program and are never freed.
+ */
+
+#ifndef _H_symbol
+#define _H_symbol
+
+class Symbol
+{
+  private:
+    const char *name;
+    int length;
+    int id;
+    unsigned int hash;
+    Symbol *chain;  // next symbol in the same bucket of the intern table
+
+    Symbol(const char *name, int length, unsigned int hash);
+    static Symbol *Add(const char *name, int length);
+
+  public:
+          // Returns the unique symbol for the given name, creating it on
+          // first use. The second form interns only the first length
+          // characters, the string need not be null-terminated.
+    static Symbol *Intern(const char *name);
+    static Symbol *Intern(const char *name, int length);
+
+          // Returns the number of distinct symbols interned so far
+    static int NumSymbols();
+
+          // Turns on locking around Intern, needed while more than one
+          // thread scans (see batch.h)
+    static void SetLocking(bool on);
+
+    const char *GetName() const  { return name; }
+    int GetLength() const        { return length; }
+    int GetId() const            { return id; }
+    unsigned int GetHash() const { return hash; }
+};
+
+#endif
@@ -0,0 +1,163 @@
+/* File: trace.cc
+ * --------------
+ * Implementation of the trace channels and the event ring buffer.
+ */
+
+#include "trace.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "utility.h"
+using namespace std;
+
+unsigned char traceFlags[kNumTraceChannels];
+
+struct ChannelInfo {
+    const char *name;
+    const char *arg1, *arg2;   // what the event numbers are, NULL if unused
+    bool hasEvents;
+};
+
+static const ChannelInfo channels[kNumTraceChannels] = {
+    { "lex" }, { "parser" },
+    { "scope", "line", "depth", true },
+    { "lookup", "depth", "found", true },
+    { "resolve" }, { "arena" }, { "types" }, { "astcache" },
+    { "passes", NULL, NULL, true },
+};
+
+static const int BufferSize = 2048;
+
+void PrintTraceMessage(TraceChannel channel, const char *format, ...)
+{
+  va_list args;
+  char buf[BufferSize];
+
+  va_start(args, format);
+  vsprintf(buf, format, args);
+  va_end(args);
+  printf("+++ (%s): %s%s", channels[channel].name, buf,
+         buf[strlen(buf)-1] != '\n'? "\n" : "");
+}
+
+void SetDebugForKey(const char *key, bool value)
+{
+  for (int c = 0; c < kNumTraceChannels; c++) {
+    if (strcmp(channels[c].name, key) != 0) continue;
+    if (value)
+      traceFlags[c] |= kTracePrint;
+    else
+      traceFlags[c] &= ~kTracePrint;
+  }
+}
+
+
+struct Event {
+    int64_t time;        // ns since tracing started
+    const char *name;
+    int arg1, arg2;
+    unsigned short thread;
+    char phase;
+    unsigned char channel;
+};
+
+static const unsigned RingSize = 1 << 20;   // a power of two
+static Event *ring;
+static atomic<unsigned> nextSlot(0);
+static atomic<int> numThreads(0);
+static chrono::steady_clock::time_point startTime;
+static const char *tracePath;
+
+bool StartTracing(const char *path, const char *channelList)
+{
+  bool record[kNumTraceChannels] = { false };
+  for (const char *name = channelList; *name; ) {
+    size_t len = strcspn(name, ",");
+    int c = 0;
+    while (c < kNumTraceChannels && (strlen(channels[c].name) != len ||
+                                     strncmp(channels[c].name, name, len) != 0))
+      c++;
+    if (c == kNumTraceChannels || !channels[c].hasEvents)
+      return false;
+    record[c] = true;
+    name += name[len] ? len + 1 : len;
+  }
+
+  tracePath = path;
+  ring = new Event[RingSize];
+  startTime = chrono::steady_clock::now();
+  for (int c = 0; c < kNumTraceChannels; c++)
+    if (record[c])
+      traceFlags[c] |= kTraceRecord;
+  return true;
+}
+
+static int ThreadNumber()
+{
+  static thread_local int number = -1;
+  if (number < 0) number = numThreads++;
+  return number;
+}
+
+void RecordTraceEvent(TraceChannel channel, char phase, const char *name,
+                      int arg1, int arg2)
+{
+  Event &e = ring[nextSlot.fetch_add(1, memory_order_relaxed) & (RingSize - 1)];
+  e.time = chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now() - startTime).count();
+  e.name = name;
+  e.arg1 = arg1;
+  e.arg2 = arg2;
+  e.thread = ThreadNumber();
+  e.phase = phase;
+  e.channel = channel;
+}
+
+
+/* Function: WriteTrace
+ * --------------------
+ * The events are written oldest first, from the slot after the last one
+ * taken if the ring has wrapped around. The begin of a span may then
+ * have been written over while its end was kept, those ends are left
+ * out, so every span in the file has both. Names are identifiers and
+ * pass names, so they need no escaping.
+ */
+void WriteTrace()
+{
+  if (!tracePath) return;
+  FILE *fp = fopen(tracePath, "w");
+  if (!fp) {
+    fprintf(stderr, "Cannot write %s\n", tracePath);
+    return;
+  }
+  unsigned end = nextSlot, begin = end > RingSize ? end - RingSize : 0;
+  vector<int> unended(numThreads);   // spans begun on each thread
+  bool first = true;
+  fprintf(fp, "{\"traceEvents\":[");
+  for (unsigned i = begin; i != end; i++) {
+    const Event &e = ring[i & (RingSize - 1)];
+    const ChannelInfo &c = channels[e.channel];
+    if (e.phase == 'B') {
+      unended[e.thread]++;
+    } else if (e.phase == 'E') {
+      if (unended[e.thread] == 0)   // its begin was written over
+        continue;
+      unended[e.thread]--;
+    }
+    fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+            "\"pid\":1,\"tid\":%d", first ? "" : ",", e.name, c.name, e.phase,
+            e.time / 1000.0, e.thread);
+    first = false;
+    if (e.phase == 'i')
+      fprintf(fp, ",\"s\":\"t\"");
+    if (c.arg1)
+      fprintf(fp, ",\"args\":{\"%s\":%d,\"%s\":%d}", c.arg1, e.arg1, c.arg2, e.arg2);
+    fprintf(fp, "}");
+  }
+  fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  fclose(fp);
+}
@@ -0,0 +1,99 @@
+/* File: trace.h
+ * -------------
+ * Debug output and tracing go through channels, one for each part of
+ * the compiler with something to tell, all known up front:
+ *
+ *    lex, parser, scope, lookup, resolve, arena, types, astcache, passes
+ *
+ * A channel can print messages (PrintDebug, turned on with -d <channel>)
+ * and record events (TraceEvent, turned on with --trace <file>, for the
+ * channels named with --trace-channels, passes if none are). Whether
+ * a channel does either is a byte in a table, and since both are macros
+ * that test it before evaluating their arguments, a channel that is off
+ * costs one branch.
+ *
+ * The events recorded are the begin and end of each pass (passes), each
+ * declaration entered in a scope, with its line and how deep the scope
+ * is (scope), and each identifier looked up through the enclosing
+ * scopes, with how many were searched and whether it was found (lookup).
+ * There are hundreds of lookups for each pass, so scope and lookup are
+ * only recorded when asked for. The events go into a ring buffer shared
+ * by all the threads, each taking the next slot with an atomic
+ * increment, so recording never waits on a lock; once it is full, the
+ * oldest events are written over. At the end the buffer is written to
+ * the --trace file as Chrome trace-event JSON, which chrome://tracing or
+ * Perfetto show as a timeline per thread.
+ */
+
+#ifndef _H_trace
+#define _H_trace
+
+typedef enum { kTraceLex, kTraceParser, kTraceScope, kTraceLookup,
+               kTraceResolve, kTraceArena, kTraceTypes, kTraceAstCache,
+               kTracePasses, kNumTraceChannels } TraceChannel;
+
+enum { kTracePrint = 1, kTraceRecord = 2 };
+extern unsigned char traceFlags[kNumTraceChannels];
+
+
+/* Macro: PrintDebug()
+ * Usage: PrintDebug(kTraceParser, "found ident %s\n", ident);
+ * -----------------------------------------------------------
+ * Print a message if we have turned debugging messages on for the given
+ * channel.  For example, the usage line shown above will only print a
+ * message if the call is preceded by a call to
+ * SetDebugForKey("parser",true).  The macro accepts printf arguments,
+ * which are not evaluated when the channel is off.  The provided main.cc
+ * parses the command line to turn on debug flags.
+ */
+#define PrintDebug(channel, ...) \
+    do { if (traceFlags[channel] & kTracePrint) \
+             PrintTraceMessage(channel, __VA_ARGS__); } while (0)
+
+void PrintTraceMessage(TraceChannel channel, const char *format, ...);
+
+
+/* Macro: TraceEvent()
+ * Usage: TraceEvent(kTraceLookup, 'i', name, depth, found);
+ * ---------------------------------------------------------
+ * Records an event on the channel if it is being recorded. The phase is
+ * 'B' or 'E' for the begin and end of a span, 'i' for an instant. The
+ * name must outlive the run (a string constant or a symbol's name), and
+ * the two numbers are shown as the channel's arguments (see trace.cc).
+ */
+#define TraceEvent(channel, phase, name, arg1, arg2) \
+    do { if (traceFlags[channel] & kTraceRecord) \
+             RecordTraceEvent(channel, phase, name, arg1, arg2); } while (0)
+
+void RecordTraceEvent(TraceChannel channel, char phase, const char *name,
+                      int arg1, int arg2);
+
+
+/* Function: SetDebugForKey()
+ * Usage: SetDebugForKey("scope", true);
+ * -------------------------------------
+ * Turn on debugging messages for the channel of the given name.  See
+ * PrintDebug for an example.  Names that are not a channel are ignored.
+ * Can be called manually when desired and will be called from the
+ * provided main for flags passed with -d.
+ */
+void SetDebugForKey(const char *key, bool val);
+
+
+/* Function: StartTracing()
+ * ------------------------
+ * Turns on recording for the channels named in the comma separated list
+ * and sets the file WriteTrace will write them to. Returns false, and
+ * records nothing, if a name is not that of a channel with events.
+ */
+bool StartTracing(const char *path, const char *channelList);
+
+
+/* Function: WriteTrace()
+ * ----------------------
+ * Writes the events recorded to the file given to StartTracing, if it
+ * was called. No thread may be recording while this runs.
+ */
+void WriteTrace();
+
+#endif
@@ -1,16 +1,26 @@
 /* File: utiliy.cc
  * ---------------
  * Implementation of simple printing functions to report failures or
- * debugging information triggered by keys.
+ * debugging information (the debug channels themselves are in trace.cc).
  */
 
 #include "utility.h"
+#include "trace.h"
+#include "pipeline.h"
 #include <stdarg.h>
-#include "list.h"
+#include "errors.h"
 #include <string.h>
 
-static List<const char*> debugKeys;
 static const int BufferSize = 2048;
+static int numJobs = 1;
+static bool serverMode = false;
+static const char *astCachePath = NULL;
+static bool batchMode = false;
+static std::vector<const char*> batchFiles;
+static Pass lastPass = kCheckPass;
+static bool timePasses = false;
+static const char *tracePath = NULL;
+static const char *traceChannels = "passes";
 
 void Failure(const char *format, ...)
 {
@@ -27,56 +37,103 @@ void Failure(const char *format, ...)
 
 
 
-int IndexOf(const char *key)
+int NumJobs()
 {
-   for (int i = 0; i < debugKeys.NumElements(); i++)
-      if (!strcmp(debugKeys.Nth(i), key)) return i;
-   return -1;
+  return numJobs;
 }
 
-bool IsDebugOn(const char *key)
+bool ServerMode()
 {
-   return (IndexOf(key) != -1);
+  return serverMode;
 }
 
-
-void SetDebugForKey(const char *key, bool value)
+const char *AstCachePath()
 {
-  int k = IndexOf(key);
-  if (!value && k != -1)
-    debugKeys.RemoveAt(k);
-  else if (value && k == -1)
-    debugKeys.Append(key);
+  return astCachePath;
 }
 
+bool BatchMode()
+{
+  return batchMode;
+}
 
+const std::vector<const char*> &BatchFiles()
+{
+  return batchFiles;
+}
 
-void PrintDebug(const char *key, const char *format, ...)
+Pass LastPass()
 {
-  va_list args;
-  char buf[BufferSize];
+  return lastPass;
+}
 
-  if (!IsDebugOn(key))
-     return;
-  
-  va_start(args, format);
-  vsprintf(buf, format, args);
-  va_end(args);
-  printf("+++ (%s): %s%s", key, buf, buf[strlen(buf)-1] != '\n'? "\n" : "");
+bool TimePasses()
+{
+  return timePasses;
 }
 
 
+static void Usage()
+{
+  printf("Usage:   [options] -d <debug-key-1> <debug-key-2> ... \n");
+  printf("Options: -j <number-of-threads>   check declarations in parallel\n");
+  printf("         --stream-errors          print errors as they are found\n");
+  printf("         --unique-errors          print repeated errors once\n");
+  printf("         --max-errors <n>         print at most n errors\n");
+  printf("         --server                 run as a compiler server\n");
+  printf("         --ast-cache <file>       keep the parsed tree in file\n");
+  printf("         --batch <file> ...       compile each file, -j of them at once\n");
+  printf("         --stop-after <pass>      stop after read, lex, parse, declare or check\n");
+  printf("         -fsyntax-only            stop after parse\n");
+  printf("         --time-passes            print the time each pass took\n");
+  printf("         --trace <file>           write a Chrome trace of the passes to file\n");
+  printf("         --trace-channels <list>  channels to trace: passes (default), scope, lookup\n");
+  exit(2);
+}
+
 void ParseCommandLine(int argc, char *argv[])
 {
-  if (argc == 1)
-    return;
-  
-  if (strcmp(argv[1], "-d") != 0) { // first arg is not -d
-    printf("Usage:   -d <debug-key-1> <debug-key-2> ... \n");
-    exit(2);
+  int i = 1;
+  for (; i < argc && strcmp(argv[i], "-d") != 0; i++) {
+    if (strcmp(argv[i], "-j") == 0) {
+      if (i + 1 == argc || (numJobs = atoi(argv[++i])) < 1) Usage();
+    } else if (strcmp(argv[i], "--stream-errors") == 0) {
+      ReportError::SetStreaming(true);
+    } else if (strcmp(argv[i], "--unique-errors") == 0) {
+      ReportError::SetUnique(true);
+    } else if (strcmp(argv[i], "--max-errors") == 0) {
+      int max;
+      if (i + 1 == argc || (max = atoi(argv[++i])) < 1) Usage();
+      ReportError::SetMaxErrors(max);
+    } else if (strcmp(argv[i], "--server") == 0) {
+      serverMode = true;
+    } else if (strcmp(argv[i], "--ast-cache") == 0) {
+      if (i + 1 == argc) Usage();
+      astCachePath = argv[++i];
+    } else if (strcmp(argv[i], "--batch") == 0) {
+      batchMode = true;
+      while (i + 1 < argc && argv[i+1][0] != '-')
+        batchFiles.push_back(argv[++i]);
+    } else if (strcmp(argv[i], "--stop-after") == 0) {
+      if (i + 1 == argc || (lastPass = PassNamed(argv[++i])) == kNumPasses) Usage();
+    } else if (strcmp(argv[i], "-fsyntax-only") == 0) {
+      lastPass = kParsePass;
+    } else if (strcmp(argv[i], "--time-passes") == 0) {
+      timePasses = true;
+    } else if (strcmp(argv[i], "--trace") == 0) {
+      if (i + 1 == argc) Usage();
+      tracePath = argv[++i];
+    } else if (strcmp(argv[i], "--trace-channels") == 0) {
+      if (i + 1 == argc) Usage();
+      traceChannels = argv[++i];
+    } else
+      Usage();
   }
 
-  for (int i = 2; i < argc; i++)
+  if (tracePath && !StartTracing(tracePath, traceChannels))
+    Usage();
+
+  for (i++; i < argc; i++)
     SetDebugForKey(argv[i], true);
 }
 
@@ -9,6 +9,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <vector>
 
 
 /* Function: Failure()
@@ -39,45 +40,62 @@ void Failure(const char *format, ...);
   ((expr) ? (void)0 : Failure("Assertion failed: %s, line %d:\n    %s", __FILE__, __LINE__, #expr))
 
 
+/* Macro: DebugAssert()
+ * --------------------
+ * The same as Assert, except that it is left out of a build with NDEBUG
+ * defined (make BUILD=release), for checks in code too hot to pay for
+ * them there, such as the index checks of List.
+ */
+#ifdef NDEBUG
+#define DebugAssert(expr) ((void)0)
+#else
+#define DebugAssert(expr) Assert(expr)
+#endif
+
+
 
-/* Function: PrintDebug()
- * Usage: PrintDebug("parser", "found ident %s\n", ident);
- * -------------------------------------------------------
- * Print a message if we have turned debugging messages on for the given
- * key.  For example, the usage line shown above will only print a message
- * if the call is preceded by a call to SetDebugForKey("parser",true).
- * The function accepts printf arguments.  The provided main.cc parses
- * the command line to turn on debug flags. 
+/* Function: ParseCommandLine
+ * --------------------------
+ * Turn on the debugging flags from the command line.  Accepts options
+ * first (-j N, and the error output settings, see errors.h), then
+ * verifies that the next argument is -d, and then interpret all the
+ * arguments that follow as being flags to turn on.
  */
-void PrintDebug(const char *key, const char *format, ...);
+void ParseCommandLine(int argc, char *argv[]);
 
 
-/* Function: SetDebugForKey()
- * Usage: SetDebugForKey("scope", true);
- * -------------------------------------
- * Turn on debugging messages for the given key.  See PrintDebug
- * for an example. Can be called manually when desired and will
- * be called from the provided main for flags passed with -d.
+/* Function: NumJobs()
+ * -------------------
+ * Returns the number of threads the semantic checker may use, as given
+ * with -j on the command line, 1 if none was given.
  */
-void SetDebugForKey(const char *key, bool val);
+int NumJobs();
 
 
-/* Function: IsDebugOn()
- * Usage: if (IsDebugOn("scope")) ...
- * ----------------------------------
- * Return true/false based on whether this key is currently on
- * for debug printing.
+/* Function: ServerMode()
+ * ----------------------
+ * Returns whether --server was given on the command line, to run as a
+ * compiler server (see server.h) instead of compiling stdin once.
  */
-bool IsDebugOn(const char *key);
+bool ServerMode();
 
 
+/* Function: AstCachePath()
+ * ------------------------
+ * Returns the file given with --ast-cache on the command line to keep
+ * the parsed tree in (see astcache.h), NULL if none was given.
+ */
+const char *AstCachePath();
 
-/* Function: ParseCommandLine
- * --------------------------
- * Turn on the debugging flags from the command line.  Verifies that
- * first argument is -d, and then interpret all the arguments that follow
- * as being flags to turn on.
+
+/* Functions: BatchMode(), BatchFiles()
+ * ------------------------------------
+ * BatchMode returns whether --batch was given on the command line, to
+ * compile many files in one run (see batch.h). BatchFiles returns the
+ * files named after it, none if the list is to be read from stdin.
  */
-void ParseCommandLine(int argc, char *argv[]);
+bool BatchMode();
+const std::vector<const char*> &BatchFiles();
+
      
 #endif